@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <ROOT-Sim.h>
@@ -6,6 +7,13 @@
 #include "physical_layer.h"
 #include "link_layer.h"
 #include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "topology_format.h"
+#include "channel_model.h"
+#include "noise_model.h"
 
 /*
  * Default values of the parameters of the simulation
@@ -34,23 +42,45 @@ FILE* file; // Pointer to the file object associated to the configuration file
 
 unsigned int ctp_root=UINT_MAX;
 
+/*
+ * Lock and flag used to load the topology of the network only once (see "load_topology")
+ */
+
+pthread_mutex_t topology_lock=PTHREAD_MUTEX_INITIALIZER;
+bool topology_loaded=false;
+
 /* GLOBAL VARIABLES (shared among all logical processes) - end */
 
 /* FORWARD DECLARATIONS */
 
+void load_topology(void* event_content);
 void read_input_file(const char* path);
+void map_input_file(const char* path);
 void parse_simulation_parameters(void* event_content);
 void start_routing_engine(node_state* state);
 bool is_failed(simtime_t now);
-void new_pending_transmission(node_state* state, double gain, unsigned char type,void* frame,double duration);
-void transmission_finished(node_state* state,pending_transmission* finished_transmission);
+void new_pending_transmission(node_state* state,transmission_reference* reference,unsigned int size,
+                              unsigned char type);
+void finish_pending_transmissions(node_state* state);
+void dropped_transmission_finished(node_state* state,double power);
 void print_statistics(unsigned int root);
+void allocate_node_tables(node_state* state);
 
-extern gain_entry** gains_list;
+extern gain_table gains_table;
 extern noise_entry* noise_list;
+extern bool sparse_topology;
+extern bool procedural_channel;
+extern bool far_field_aggregation;
+extern bool symmetric_gains;
+extern bool tdma;
 extern double update_route_timer;
 extern double send_packet_timer;
 extern double create_packet_timer;
+extern unsigned int routing_table_size;
+extern unsigned int forwarding_pool_depth;
+extern unsigned int forwarding_queue_depth;
+extern unsigned int cache_size;
+extern unsigned int pending_transmissions_pool_size;
 /*
  * Application-level callback: this is the interface between the simulator and the model being simulated
  */
@@ -63,12 +93,6 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
 
         node_state *state;
 
-        /*
-         * Index to iterate through nodes
-         */
-
-        unsigned int i;
-
         /*
          * Initialize the local pointer to the pointer provided by the simulator
          */
@@ -97,6 +121,13 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
 
                                 state->state &= ~RUNNING;
 
+                                /*
+                                 * A failed node sends no more beacons => stop the timer for beacons, so that the firings
+                                 * already scheduled are dropped
+                                 */
+
+                                stop_timer(state,BEACON_TIMER);
+
                                 /*
                                  * Set the "failed" flag in the object representing the statistics of the node
                                  */
@@ -113,6 +144,14 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                 }
         }
 
+        /*
+         * Handle the end of the incoming transmissions that have finished by now, before the node does anything else:
+         * this is skipped until the node is started, because the list of pending transmissions is not initialized yet
+         */
+
+        if(state!=NULL && event_type!=START_NODE)
+                finish_pending_transmissions(state);
+
         /*
          * Depending on the event type, perform different tasks
          */
@@ -134,11 +173,9 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                          *
                          * Before the simulation can start, it is necessary to read the input file provided by the
                          * user, containing the description of all the links of the node, the IDs of the nodes and their
-                         * level of local noise => since this implies dynamic memory allocation, only one node (the one
-                         * with ID 0 or the one chosen by the user) performs this task, so the actual start of the other
-                         * nodes has to be deferred
-                         * => as soon as it has taken this step, an event (START_NODE) is broadcasted to all the other
-                         * nodes: at this point they can properly start.
+                         * level of local noise => this is done only once, by the first node that gets here (see
+                         * "load_topology"), while the other nodes wait for it to finish; then each node checks its own
+                         * links and schedules for itself the event (START_NODE) that starts it
                          *
                          * The following steps have to be taken by all the nodes
                          */
@@ -172,114 +209,36 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                         state->state|=RUNNING;
 
                         /*
-                         * Get the ID of the root node; if the user does not provide this parameter, the default root
-                         * is node 0.
-                         * The node chosen as root node sets the corresponding global variable to its own ID
+                         * Load the topology of the network and the parameters of the simulation, unless another node
+                         * has already done it
                          */
 
-                        if(IsParameterPresent(event_content, "root"))
-                        {
-
-                                /*
-                                 * The ID of the node
-                                 */
-
-                                unsigned int root=(unsigned int)GetParameterInt(event_content,"root");
-
-                                /*
-                                 * The user indicated the ID of the root node => check if it's valid and, if so, set
-                                 * the corresponding global value
-                                 */
-
-                                if(root<n_prc_tot) {
-                                        if(me==root)
-                                                ctp_root = root;
-                                }
-                                else{
-
-                                        /*
-                                         * Abort because of invalid "root" parameter
-                                         */
-
-                                        printf("[FATAL ERROR] The given root ID is not valid: it has to be less that"
-                                                       "the number of LPs\n");
-                                        free((state));
-                                        exit(EXIT_FAILURE);
-                                }
-                        }
-                        else{
-
-                                /*
-                                 * The user did not choose any node as root => the node with ID 0 declares itself to
-                                 * be the root
-                                 */
-
-                                if(!me)
-                                        ctp_root=0;
-                        }
+                        load_topology(event_content);
 
                         /*
-                         * All logical processes (except root node) stop here, waiting for the signal to start the node
+                         * Check the links of this node
                          */
 
-                        if(me==ctp_root){
+                        check_gain_row(me);
 
-                                /* READ INPUT FILE (ONLY THE ROOT NODE) - start */
-
-                                /*
-                                 * Parse the input file containing all the links of the network, including their gains,
-                                 * and the noise affecting all the nodes: if the path to the file is not given, return
-                                 * with error
-                                 */
-
-                                if(IsParameterPresent(event_content, "input")) {
-                                        read_input_file(GetParameterString(event_content, "input"));
-                                }
-                                else{
-                                        printf("[FATAL ERROR] The path to a file containing the configuration  of the "
-                                                       "network"
-                                                       " is mandatory => "
-                                                       "specify it after "
-                                                       "the argument \"path\"\n");
-                                        free((state));
-                                        exit(EXIT_FAILURE);
-                                }
-
-                                /* READ INPUT FILE (ONLY THE ROOT NODE) - end */
-
-                                /*
-                                 * Now parse all the other parameters of the simulation
-                                 */
+                        /*
+                         * Convert the noise floor of this node to linear units and compute its background power
+                         */
 
-                                parse_simulation_parameters(event_content);
+                        init_node_noise(me);
 
-                                /*
-                                 * Set the "root" flag in the state object
-                                 */
+                        /*
+                         * Set the "root" flag in the state object if this is the root node
+                         */
 
+                        if(me==ctp_root)
                                 state->root=true;
 
-                                /*
-                                 * Allocate the array for statistics about nodes
-                                 */
-
-                                node_statistics_list=malloc(sizeof(node_statistics)*n_prc_tot);
-
-                                /*
-                                 * Initialize elements to 0
-                                 */
-
-                                bzero(node_statistics_list,sizeof(node_statistics)*n_prc_tot);
-
-                                /*
-                                 * All the parameters of the configuration have been parsed => tell all the processes
-                                 * that the time to start the simulation has come
-                                 */
+                        /*
+                         * Everything the node needs is ready => schedule the start of the node
+                         */
 
-                                for(i=0;i<n_prc_tot;i++) {
-                                        ScheduleNewEvent(i, now+1, START_NODE, NULL, 0);
-                                }
-                        }
+                        wait_until(me,now+1,START_NODE);
 
                         break;
 
@@ -306,6 +265,12 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
 
                         state->me=me;
 
+                        /*
+                         * Allocate the tables of the node, whose size is given by the parameters of the simulation
+                         */
+
+                        allocate_node_tables(state);
+
                         /* INIT PHYSICAL LAYER - start */
 
                         init_physical_layer(state);
@@ -387,12 +352,30 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
 
                 case SEND_BEACONS_TIMER_FIRED:
 
+                        /*
+                         * If the timer for beacons has been restarted since this event was scheduled, ignore it
+                         */
+
+                        if(!is_timer_current(state,BEACON_TIMER,event_content,size))
+                                break;
+
                         /*
                          * If the node is not running, do nothing
                          */
 
                         if(state->state&RUNNING) {
 
+                                /*
+                                 * The interval of the timer that schedules the sending of beacons is continuously
+                                 * changing, in such a way that beacons are sent with decreasing frequency => schedule
+                                 * an update of the timer, i.e. advance in the virtual time until the moment when the
+                                 * timer has to be updated.
+                                 * This is done first, so that if the interval is reset while updating the route or
+                                 * sending the beacon, the new schedule replaces this update
+                                 */
+
+                                schedule_beacons_interval_update(state);
+
                                 /*
                                  * It's time for the ROUTING ENGINE to send a beacon to its neighbors => before doing
                                  * this, update the route, so that information reported in the beacon will not be
@@ -406,20 +389,18 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                                  */
 
                                 send_beacon(state);
-
-                                /*
-                                 * The interval of the timer that schedules the sending of beacons is continuously
-                                 * changing, in such a way that beacons are sent with decreasing frequency => schedule
-                                 * an update of the timer, i.e. advance in the virtual time until the moment when the
-                                 * timer has to be updated
-                                 */
-
-                                schedule_beacons_interval_update(state);
                         }
                         break;
 
                 case SET_BEACONS_TIMER:
 
+                        /*
+                         * If the timer for beacons has been restarted since this event was scheduled, ignore it
+                         */
+
+                        if(!is_timer_current(state,BEACON_TIMER,event_content,size))
+                                break;
+
                         /*
                          * If the node is not running, do nothing
                          */
@@ -618,9 +599,7 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                          * it may interfere with other the transmission of other frames.
                          */
 
-                        new_pending_transmission(state,((ctp_routing_packet*)event_content)->link_frame.gain,
-                                                         CTP_BEACON,event_content,
-                                                         ((ctp_routing_packet*)event_content)->link_frame.duration);
+                        new_pending_transmission(state,(transmission_reference*)event_content,size,CTP_BEACON);
                         break;
 
                 case TRANSMISSION_DATA_PACKET_STARTED:
@@ -632,20 +611,29 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                          * node and it may interfere with other the transmission of other frames.
                          */
 
-                        new_pending_transmission(state,((ctp_data_packet*)event_content)->link_frame.gain,
-                                                 CTP_DATA_PACKET,event_content,
-                                                 ((ctp_data_packet*)event_content)->link_frame.duration);
+                        new_pending_transmission(state,(transmission_reference*)event_content,size,CTP_DATA_PACKET);
                         break;
 
                 case TRANSMISSION_FINISHED:
 
                         /*
-                         * The transmission of the beacon has come to an end => the associated signal is no longer
-                         * perceived by the node. If the signal was strong enough, the node received the frame and
-                         * starts processing it.
+                         * The transmission of a frame the node is able to receive has come to an end => the associated
+                         * signal is no longer perceived by the node. If the signal was still strong enough, the node
+                         * received the frame and starts processing it.
+                         * This has already been done at the beginning of the event, together with all the other
+                         * transmissions that have finished by now: the event only has to wake the node up in time
+                         */
+
+                        break;
+
+                case DROPPED_TRANSMISSION_FINISHED:
+
+                        /*
+                         * A transmission the node had no room for has come to an end => remove its signal from the
+                         * one perceived by the node
                          */
 
-                        transmission_finished(state,(pending_transmission*)event_content);
+                        dropped_transmission_finished(state,*(double*)event_content);
                         break;
 
                 case ACK_RECEIVED:
@@ -665,8 +653,10 @@ void ProcessEvent(unsigned int me, simtime_t now, int event_type, void *event_co
                                 //state->last_packet_acked=(ctp_data_packet*)event_content;
                                 state->last_packet_acked.link_frame.sink=((ctp_data_packet*)event_content)->link_frame.sink;
                                 state->last_packet_acked.link_frame.src=((ctp_data_packet*)event_content)->link_frame.src;
+                                state->last_packet_acked.link_frame.seq=((ctp_data_packet*)event_content)->link_frame.seq;
                                 state->last_packet_acked.link_frame.duration=((ctp_data_packet*)event_content)->link_frame.duration;
                                 state->last_packet_acked.link_frame.gain=((ctp_data_packet*)event_content)->link_frame.gain;
+                                state->last_packet_acked.link_frame.gain_mw=((ctp_data_packet*)event_content)->link_frame.gain_mw;
                                 state->last_packet_acked.payload=((ctp_data_packet*)event_content)->payload;
                                 state->last_packet_acked.data_packet_frame.ETX=((ctp_data_packet*)event_content)->data_packet_frame.ETX;
                                 state->last_packet_acked.data_packet_frame.options=((ctp_data_packet*)event_content)->data_packet_frame.options;
@@ -724,6 +714,13 @@ bool OnGVT(unsigned int me, void*snapshot) {
 
         unsigned int i;
 
+        /*
+         * The transmissions of the node in the snapshot are committed => their slots of the broadcast buffer can be
+         * reused
+         */
+
+        commit_transmissions(me,(node_state*)snapshot);
+
         /*
          * If nodes have not started yet, return false
          */
@@ -889,6 +886,62 @@ void wait_until(unsigned int me,simtime_t timestamp,unsigned int type){
         }
 }
 
+/*
+ * START TIMER
+ *
+ * Start (or restart) the given timer of the node, so that it fires at the given time: the event scheduled carries the
+ * new generation of the timer, so any firing scheduled before (and not processed yet) is superseded by this one
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @timer: ID of the timer (see "TIMERS" in application.h)
+ * @timestamp: virtual clock time when the timer will be fired
+ * @type: ID corresponding to the event delivered when the timer fires
+ */
+
+void start_timer(node_state* state,unsigned int timer,simtime_t timestamp,unsigned int type){
+
+        /*
+         * Move to the next generation of the timer
+         */
+
+        state->timer_generations[timer]++;
+
+        /*
+         * Schedule the firing, tagged with the generation
+         */
+
+        ScheduleNewEvent(state->me,timestamp,type,&state->timer_generations[timer],sizeof(unsigned int));
+}
+
+/*
+ * STOP TIMER
+ *
+ * Stop the given timer of the node: any firing already scheduled is ignored when it's delivered
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @timer: ID of the timer (see "TIMERS" in application.h)
+ */
+
+void stop_timer(node_state* state,unsigned int timer){
+        state->timer_generations[timer]++;
+}
+
+/*
+ * IS TIMER CURRENT
+ *
+ * Returns true if the event being processed is the last firing scheduled for the given timer, false if it has been
+ * superseded (i.e. the timer was restarted or stopped after the event was scheduled) and has to be ignored
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @timer: ID of the timer (see "TIMERS" in application.h)
+ * @event_content: content of the event
+ * @size: size of the content of the event
+ */
+
+bool is_timer_current(node_state* state,unsigned int timer,void* event_content,unsigned int size){
+        return size==sizeof(unsigned int) && *(unsigned int*)event_content==state->timer_generations[timer];
+}
+
 /*
  * PARSE GAIN ENTRY
  *
@@ -928,7 +981,7 @@ void parse_gain_entry(const char* tokens[]){
         sscanf(tokens[2],"%lf",&gain);
 
         /*
-         * Store parameters in a new instance of type "gain_entry"
+         * Add the link to the ones read so far
          */
 
         add_gain_entry(source,sink,gain);
@@ -980,6 +1033,370 @@ void parse_noise_entry(const char* tokens[]){
         add_noise_entry(node,floor,range);
 }
 
+/*
+ * ALIGN TABLE SIZE
+ *
+ * Round the given number of bytes up to a multiple of the alignment of any type, so that the table following in the
+ * arena of the node is aligned
+ *
+ * @size: number of bytes
+ */
+
+static size_t align_table_size(size_t size){
+        return (size+_Alignof(max_align_t)-1)/_Alignof(max_align_t)*_Alignof(max_align_t);
+}
+
+/*
+ * ALLOCATE NODE TABLES
+ *
+ * Allocate the tables of the node whose size is chosen when the simulation starts: the link estimator table, the
+ * routing table, the heap of the candidate parents, the forwarding pool, the forwarding queue, the output cache and the
+ * pool of pending transmissions, with the arrays of the in-flight transmissions.
+ * They are all carved out of a single block of memory (arena), allocated once when the node starts: the block is
+ * allocated by the logical process itself, so it's saved and restored by the simulator together with the rest of the
+ * state of the node, and it's only as large as the tables used in the current simulation
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+void allocate_node_tables(node_state* state){
+
+        /*
+         * Number of bytes of each table, rounded up so that the following table is aligned: the estimator table also
+         * holds its columns and its index (see "link_estimator.c")
+         */
+
+        size_t estimator_size=align_table_size(get_link_estimator_table_size());
+        size_t routing_size=align_table_size(sizeof(routing_table_entry)*routing_table_size);
+        size_t candidates_size=align_table_size(sizeof(unsigned char)*routing_table_size);
+        size_t pool_size=align_table_size(sizeof(forwarding_queue_entry)*forwarding_pool_depth);
+        size_t queue_size=align_table_size(sizeof(forwarding_queue_entry*)*forwarding_queue_depth);
+        size_t cache_bytes=align_table_size(sizeof(ctp_data_packet)*cache_size);
+        size_t transmissions_size=align_table_size(sizeof(pending_transmission)*pending_transmissions_pool_size);
+        size_t powers_size=align_table_size(sizeof(double)*pending_transmissions_pool_size);
+        size_t ends_size=align_table_size(sizeof(simtime_t)*pending_transmissions_pool_size);
+        size_t flags_size=align_table_size(sizeof(unsigned char)*pending_transmissions_pool_size);
+
+        /*
+         * Allocate the arena, with all the tables cleared
+         */
+
+        char* arena=calloc(1,estimator_size+routing_size+candidates_size+pool_size+queue_size+cache_bytes+
+                             transmissions_size+powers_size+ends_size+2*flags_size);
+        if(!arena){
+                printf("[FATAL ERROR] Not enough memory to allocate the tables of node %d\n",state->me);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Set the pointers to the tables, one after the other
+         */
+
+        state->link_estimator_table=(link_estimator_table_entry*)arena;
+        arena+=estimator_size;
+        state->routing_table=(routing_table_entry*)arena;
+        arena+=routing_size;
+        state->parent_candidates=(unsigned char*)arena;
+        arena+=candidates_size;
+        state->forwarding_pool=(forwarding_queue_entry*)arena;
+        arena+=pool_size;
+        state->forwarding_queue=(forwarding_queue_entry**)arena;
+        arena+=queue_size;
+        state->output_cache=(ctp_data_packet*)arena;
+        arena+=cache_bytes;
+        state->pending_transmissions_pool=(pending_transmission*)arena;
+        arena+=transmissions_size;
+        state->pending_transmissions_powers=(double*)arena;
+        arena+=powers_size;
+        state->pending_transmissions_ends=(simtime_t*)arena;
+        arena+=ends_size;
+        state->pending_transmissions_lost=(unsigned char*)arena;
+        arena+=flags_size;
+        state->pending_transmissions_slots=(unsigned char*)arena;
+}
+
+/*
+ * LOAD TOPOLOGY
+ *
+ * Parse the parameters of the simulation, read the input file and allocate the statistics of the nodes: these are
+ * shared by all the logical processes, so this is done only once, by the first logical process that invokes this
+ * function, while the others wait for it to finish (if they are run by other threads) and then return immediately.
+ * The links of each node are then checked by the node itself (see "check_gain_row"), so that the time spent before the
+ * simulation starts is only the time to read the input file, which is negligible if it is in the binary format.
+ *
+ * @event_content: parameters of the simulation, as given by the simulator with the INIT event
+ */
+
+void load_topology(void* event_content){
+
+        /*
+         * Lock the topology, so that only one logical process at a time can get past this point
+         */
+
+        pthread_mutex_lock(&topology_lock);
+
+        /*
+         * Check if the topology has already been loaded: if so, there's nothing left to do
+         */
+
+        if(topology_loaded){
+                pthread_mutex_unlock(&topology_lock);
+                return;
+        }
+
+        /*
+         * Get the ID of the root node; if the user does not provide this parameter, the default root is node 0
+         */
+
+        if(IsParameterPresent(event_content, "root"))
+                ctp_root=(unsigned int)GetParameterInt(event_content,"root");
+        else
+                ctp_root=0;
+
+        /*
+         * Check if the ID of the root is valid: if not, abort
+         */
+
+        if(ctp_root>=n_prc_tot){
+                printf("[FATAL ERROR] The given root ID is not valid: it has to be less that"
+                               "the number of LPs\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Parse all the other parameters of the simulation first: some of them (e.g. whether the topology is sparse)
+         * affect the way the input file is read
+         */
+
+        parse_simulation_parameters(event_content);
+
+        /*
+         * If the far field is aggregated, allocate the background power of the nodes, which is computed while the
+         * links are read
+         */
+
+        if(far_field_aggregation)
+                allocate_far_field();
+
+        /*
+         * If a trace of the noise is given, read it: the noise of the nodes is then taken from the trace. This has to
+         * be done before the links are read, since the lowest noise of the nodes determines which links are audible
+         */
+
+        if(IsParameterPresent(event_content, "noise_trace"))
+                read_noise_trace(GetParameterString(event_content, "noise_trace"));
+
+        /*
+         * Parse the input file containing all the links of the network, including their gains, and the noise affecting
+         * all the nodes; alternatively, read the coordinates of the nodes, from which the gains of the links are
+         * computed while the simulation runs (see "channel_model.c"): if neither path is given, return with error
+         */
+
+        if(IsParameterPresent(event_content, "coordinates")) {
+                read_coordinates_file(GetParameterString(event_content, "coordinates"));
+        }
+        else if(IsParameterPresent(event_content, "input")) {
+                read_input_file(GetParameterString(event_content, "input"));
+        }
+        else{
+                printf("[FATAL ERROR] The path to a file containing the configuration  of the network is mandatory => "
+                               "specify it after the argument \"path\"\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Allocate the array where the noise floors in linear units are stored
+         */
+
+        allocate_noise_floors();
+
+        /*
+         * Allocate the buffer where the nodes store the frames they transmit
+         */
+
+        allocate_broadcast_buffer();
+
+        /*
+         * If TDMA is used, assign the slots to the nodes
+         */
+
+        if(tdma)
+                build_tdma_schedule();
+
+        /*
+         * Allocate the array for statistics about nodes and initialize its elements to 0
+         */
+
+        node_statistics_list=malloc(sizeof(node_statistics)*n_prc_tot);
+        bzero(node_statistics_list,sizeof(node_statistics)*n_prc_tot);
+
+        /*
+         * The topology is ready => release the lock
+         */
+
+        topology_loaded=true;
+        pthread_mutex_unlock(&topology_lock);
+}
+
+/*
+ * MAP INPUT FILE
+ *
+ * Map in memory an input file in the binary format (see "topology_format.h") and use its content as the gain table and
+ * the noise list: nothing has to be parsed or allocated, so this takes the same time whatever the size of the network.
+ * Only the header and the offsets are checked here, while the links of each node are checked by the node itself.
+ * The mapping is read-only and it is shared by all the logical processes; the pages of the file are loaded by the
+ * operating system the first time they are accessed.
+ * If the topology is sparse or the far field is aggregated, some links have to be dropped => in this case the gain
+ * table is rebuilt from the links in the file (see "build_gain_table"), as well as if the gains are symmetric.
+ *
+ * @path: filename of the input file
+ */
+
+void map_input_file(const char* path){
+
+        /*
+         * File descriptor of the input file
+         */
+
+        int descriptor;
+
+        /*
+         * Information about the input file, including its size
+         */
+
+        struct stat file_stats;
+
+        /*
+         * Address where the input file is mapped
+         */
+
+        char* mapping;
+
+        /*
+         * Header of the input file
+         */
+
+        topology_header* header;
+
+        /*
+         * Index of the node
+         */
+
+        unsigned int node;
+
+        /*
+         * Index of the link
+         */
+
+        unsigned int link;
+
+        /*
+         * Open the file in READ_ONLY mode and get its size
+         */
+
+        descriptor=open(path,O_RDONLY);
+        if(descriptor<0 || fstat(descriptor,&file_stats)<0){
+                printf("[FATAL ERROR] Provided path doesn't correspond to any file or it cannot be "
+                               "accessed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the file is large enough to contain the header
+         */
+
+        if((size_t)file_stats.st_size<sizeof(topology_header)){
+                printf("[FATAL ERROR] The binary input file is truncated\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Map the whole file in memory; the file descriptor is no longer needed after this
+         */
+
+        mapping=mmap(NULL,(size_t)file_stats.st_size,PROT_READ,MAP_SHARED,descriptor,0);
+        close(descriptor);
+        if(mapping==MAP_FAILED){
+                printf("[FATAL ERROR] The binary input file cannot be mapped in memory\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check the header: the version has to be supported and the number of nodes has to coincide with the number of
+         * LPs
+         */
+
+        header=(topology_header*)mapping;
+        if(header->version!=TOPOLOGY_VERSION){
+                printf("[FATAL ERROR] Version %u of the binary input file is not supported (expected %u): convert the "
+                               "text input file again\n",header->version,TOPOLOGY_VERSION);
+                exit(EXIT_FAILURE);
+        }
+        if(header->nodes!=n_prc_tot){
+                printf("[FATAL ERROR] The binary input file describes %u nodes; they have to be %u\n",header->nodes,
+                       n_prc_tot);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that all the sections are aligned and entirely contained in the file
+         */
+
+        if(header->offsets_position%8 || header->sinks_position%8 || header->gains_position%8 ||
+           header->noise_position%8 ||
+           header->offsets_position+sizeof(uint32_t)*(header->nodes+1)>(uint64_t)file_stats.st_size ||
+           header->sinks_position+sizeof(uint32_t)*header->links>(uint64_t)file_stats.st_size ||
+           header->gains_position+sizeof(int16_t)*header->links>(uint64_t)file_stats.st_size ||
+           header->noise_position+sizeof(topology_noise)*header->nodes>(uint64_t)file_stats.st_size){
+                printf("[FATAL ERROR] The binary input file is not well formed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Point the gain table and the noise list to the corresponding sections of the file
+         */
+
+        gains_table.offsets=(unsigned int*)(mapping+header->offsets_position);
+        gains_table.sinks=(unsigned int*)(mapping+header->sinks_position);
+        gains_table.gains=(int16_t*)(mapping+header->gains_position);
+        noise_list=(noise_entry*)(mapping+header->noise_position);
+
+        /*
+         * Check that the offsets are consistent with the number of links
+         */
+
+        if(gains_table.offsets[0] || gains_table.offsets[n_prc_tot]!=header->links){
+                printf("[FATAL ERROR] The binary input file is not well formed\n");
+                exit(EXIT_FAILURE);
+        }
+        for(node=0;node<n_prc_tot;node++){
+                if(gains_table.offsets[node]>gains_table.offsets[node+1]){
+                        printf("[FATAL ERROR] The binary input file is not well formed\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        /*
+         * Check that the values for the noise are correct for all the nodes
+         */
+
+        check_noises_list();
+
+        /*
+         * If the topology is sparse or the far field is aggregated, rebuild the gain table from the links in the file,
+         * so that the ones whose transmissions are not delivered to their sink node are dropped; if the gains are
+         * symmetric, the gains of the pairs of nodes are built from the links as well
+         */
+
+        if(sparse_topology || far_field_aggregation || symmetric_gains){
+                for(node=0;node<n_prc_tot;node++){
+                        for(link=gains_table.offsets[node];link<gains_table.offsets[node+1];link++)
+                                add_gain_entry(node,gains_table.sinks[link],dequantize_gain(gains_table.gains[link]));
+                }
+                build_gain_table();
+        }
+}
+
 /*
  * READ INPUT FILE
  *
@@ -994,10 +1411,14 @@ void parse_noise_entry(const char* tokens[]){
  * "noise"\t node_id\t noise_floor\t gaussian_white_noise\n
  *
  * Such file can be easily generated using the "LinkLayerModel" from the TOSSIM simulator.
+ * The file can also be in the binary format described in "topology_format.h", which is recognized by its first bytes:
+ * in this case it is mapped in memory rather than parsed (see "map_input_file").
  * Being n the number of LPs of the simulation, this function reads at most n(n-1) lines starting with the word "gain"
  * and up to n lines starting with the word "noise". The file has to provide the description of at least one link for
  * each of the n nodes in the simulation, while the description of the noise is not mandatory: if the value of the noise
  * for a node is missing, a default value is used.
+ * If the topology is sparse (parameter "sparse_topology"), links may be omitted from the file and the ones that are
+ * not audible by their sink node are dropped once the file has been read.
  *
  * @path: filename of the input file
  *
@@ -1020,6 +1441,12 @@ void read_input_file(const char* path){
         size_t len=0;
         char * lineptr=NULL;
 
+        /*
+         * Buffer for the first bytes of the file, used to recognize the binary format
+         */
+
+        char magic[TOPOLOGY_MAGIC_LENGTH];
+
         /*
          * Get the file object in READ_ONLY mode
          */
@@ -1037,18 +1464,21 @@ void read_input_file(const char* path){
         }
 
         /*
-         * The path is valid => allocate a new array of pointers to "gain_entry" with a number of elements equal to the
-         * number of LPs: each element of the array contains the list of the links of the node, including the value of
-         * their associated gains
+         * Check if the file is in the binary format: if so, map it in memory instead of parsing it
          */
 
-        gains_list=malloc(sizeof(gain_entry*)*n_prc_tot);
+        if(fread(magic,1,TOPOLOGY_MAGIC_LENGTH,file)==TOPOLOGY_MAGIC_LENGTH &&
+           !memcmp(magic,TOPOLOGY_MAGIC,TOPOLOGY_MAGIC_LENGTH)){
+                fclose(file);
+                map_input_file(path);
+                return;
+        }
 
         /*
-         * Initialize allocated area of memory
+         * The file is in the text format => go back to its beginning
          */
 
-        bzero(gains_list,sizeof(gain_entry*)*n_prc_tot);
+        rewind(file);
 
         /*
          * Allocate an array containing an instance of type "noise_entry" for each node: this will be initialized to
@@ -1184,16 +1614,18 @@ void read_input_file(const char* path){
         fclose(file);
 
         /*
-         * Check that the list of gains is correct for all the nodes
+         * Check that the values for the noise are correct for all the nodes
          */
 
-        check_gains_list();
+        check_noises_list();
 
         /*
-         * Check that the values for the noise are correct for all the nodes
+         * Build the gain table from the links read: if the topology is sparse, the links that are not audible by their
+         * sink node are dropped, which requires the noise of all the nodes => this can only be done after the whole file
+         * has been read
          */
 
-        check_noises_list();
+        build_gain_table();
 }
 
 /*
@@ -1210,6 +1642,8 @@ void parse_simulation_parameters(void* event_content) {
         parse_link_estimator_parameters(event_content);
         parse_routing_engine_parameters(event_content);
         parse_forwarding_engine_parameters(event_content);
+        parse_channel_model_parameters(event_content);
+        parse_noise_model_parameters(event_content);
         if(IsParameterPresent(event_content, "failure_lambda"))
                 failure_lambda=GetParameterDouble(event_content,"failure_lambda");
         if(IsParameterPresent(event_content, "failure_threshold"))
@@ -1218,6 +1652,7 @@ void parse_simulation_parameters(void* event_content) {
                 max_simulation_time = GetParameterDouble(event_content, "max_simulation_time");
         if(IsParameterPresent(event_content, "collected_packets_goal"))
                 collected_packets_goal=(unsigned long long)GetParameterInt(event_content,"collected_packets_goal");
+        convert_physical_layer_parameters();
 }
 
 /*
@@ -7,6 +7,8 @@
 #include <ROOT-Sim.h>
 #include <math.h>
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 /*
  * PARAMETERS OF THE SIMULATION - start
@@ -84,7 +86,8 @@ enum{
         FRAME_TRANSMITTED=11, // The frame has been transmitted
         TRANSMISSION_BEACON_STARTED=12, // The transmission of a new frame containing a beacon has started
         TRANSMISSION_DATA_PACKET_STARTED=13, // The transmission of a new frame containing a data packet has started
-        TRANSMISSION_FINISHED=14 // The transmission of a new frame has finished
+        TRANSMISSION_FINISHED=14, // The transmission of a frame the node is receiving has finished
+        DROPPED_TRANSMISSION_FINISHED=15 // A transmission the node had no room for has finished
 };
 
 /*
@@ -112,6 +115,18 @@ enum{
         RUNNING=0x10 // The node is running => has not failed (yet)
 };
 
+/*
+ * TIMERS
+ *
+ * Timers of the node that can be restarted or stopped before they fire (see "start_timer"): every timer can have
+ * different events scheduled, but only the last one scheduled is processed
+ */
+
+enum{
+        BEACON_TIMER=0, // Drives the Trickle schedule of beacons (SEND_BEACONS_TIMER_FIRED and SET_BEACONS_TIMER)
+        TIMERS_COUNT=1 // Number of timers of the node
+};
+
 /*
  * CTP CONSTANTS
  */
@@ -132,12 +147,20 @@ typedef struct _link_layer_frame{
         unsigned int src; // ID of the node that sends the frame
         unsigned int sink; // ID of the node the frame is destined to
 
+        /*
+         * Sequence number of the transmission of the frame, local to the sender: together with the ID of the sender, it
+         * uniquely identifies the transmission (see "transmit_frame")
+         */
+
+        unsigned int seq;
+
         /*
          * Gain of the sender node: this is used by the simulator to determine whether the a frame will be received by
          * a node or not
          */
 
         double gain;
+        double gain_mw; // Gain of the sender node in mW, used to sum the power of the signals sensed by a node
         double duration; // Time necessary to deliver the packet; this depends on the size of the packet
 }link_layer_frame;
 
@@ -229,22 +252,51 @@ typedef struct _route_info{
 typedef struct _routing_table_entry{
         unsigned int neighbor;
         route_info info;
+        unsigned short one_hop_etx; // 1-hop ETX of the link to the neighbor, as last reported by the link estimator
+
+        /*
+         * Position of the entry in the heap of the candidate parents of the node (see "routing_engine.c"), or
+         * NOT_A_CANDIDATE if the neighbor can't be selected as parent
+         */
+
+        unsigned char candidate;
 }routing_table_entry;
 
 /*
  * GAIN ENTRY
  *
  * Data structure representing the gain associated to a single directed wireless link.
- * The value of the gain is provided by the input file of the simulation.
- * For each node of the simulation there's a list of elements of such type, one for each of its links
+ * The value of the gain is provided by the input file of the simulation: the links are collected in an array of
+ * elements of such type while the file is read and they are then moved to the gain table (see below)
  */
 
 typedef struct _gain_entry{
-        double gain; // Gain associated to the link
+        unsigned int source; // ID of the source node of the link
         unsigned int sink; // ID of the sink node of the link
-        struct _gain_entry* next; // Pointer to the next entry in the list of gains
+        int16_t gain; // Gain associated to the link, in hundredths of dB (see "quantize_gain")
 }gain_entry;
 
+/*
+ * GAIN TABLE
+ *
+ * Compressed representation of the gains of all the links of the network (Compressed Sparse Row format): the links
+ * having node i as source node are stored contiguously, from position offsets[i] to position offsets[i+1] (excluded),
+ * in two parallel arrays containing the sink node and the gain of each link.
+ * The gains are quantized to 16 bits (see "quantize_gain") and they are converted to mW only when a frame is sent
+ * through the link, so the table takes 6 bytes per link.
+ * If the gains are symmetric (parameter "symmetric_gains"), the table rather stores a single gain for each unordered
+ * pair of nodes, in a triangular matrix without the sink nodes (see "get_pair_index"), i.e. 1 byte per link when all
+ * the links of the network are given: the matrix has room for all the pairs, so it's not used with a sparse topology.
+ * The table is built only once, after the input file has been read, and it is never modified afterwards
+ */
+
+typedef struct _gain_table{
+        unsigned int* offsets; // Position of the first link of each node (n_prc_tot+1 elements)
+        unsigned int* sinks; // ID of the sink node of each link
+        int16_t* gains; // Gain associated to each link, in hundredths of dB
+        int16_t* pair_gains; // Gain associated to each pair of nodes, if the gains are symmetric (NULL otherwise)
+}gain_table;
+
 /*
  * NOISE ENTRY
  *
@@ -272,12 +324,46 @@ union transmission_frame{
 };
 
 
+/*
+ * PENDING TRANSMISSIONS POOL SIZE
+ *
+ * Default number of frames that a node can hold for the transmissions it is sensing at the same time (see the parameter
+ * "pending_transmissions_pool_size"): the pending transmissions are stored in a pool of slots carved out of the tables
+ * of the node (see "allocate_node_tables"), so that no memory has to be allocated when a transmission starts and the
+ * pending transmissions are restored together with the rest of the state in case of rollback.
+ * The value has to be smaller than 255 (the value of NO_PENDING_TRANSMISSION is reserved)
+ */
+
+#ifndef PENDING_TRANSMISSIONS_POOL_SIZE
+#define PENDING_TRANSMISSIONS_POOL_SIZE 32
+#endif
+
+#ifndef NO_PENDING_TRANSMISSION
+#define NO_PENDING_TRANSMISSION 0xff // Index used to mark the end of a list of slots of the pool
+#endif
+
+_Static_assert(PENDING_TRANSMISSIONS_POOL_SIZE>0 && PENDING_TRANSMISSIONS_POOL_SIZE<NO_PENDING_TRANSMISSION,
+               "PENDING_TRANSMISSIONS_POOL_SIZE has to be between 1 and NO_PENDING_TRANSMISSION-1");
+
+/*
+ * NOISE HISTORY SIZE
+ *
+ * Max number of past samples of the noise that determine the next one, when the noise is taken from a trace (see
+ * "noise_model.c"): the samples are stored in the state of the node, so they are restored in case of rollback
+ */
+
+#ifndef NOISE_HISTORY_SIZE
+#define NOISE_HISTORY_SIZE 20
+#endif
+
 /*
  * PENDING TRANSMISSION
  *
- * Data structure representing the transmission of a frame.
+ * Data structure representing the frame carried by a transmission.
  * More than one frame may be sent to a node at the same time, but it will receive only the one associated with the
  * strongest signal, given that the strength is greater than the noise affecting the node.
+ * The power, the end and the lost flag of the transmission are not stored here, but in the arrays of the in-flight
+ * transmissions of the node (see "node_state"), which are scanned every time a new signal comes
  */
 
 typedef struct _pending_transmission{
@@ -288,11 +374,66 @@ typedef struct _pending_transmission{
 
         union transmission_frame frame;
         unsigned char frame_type; // The type of the frame, either CTP_BEACON or CTO_DATA_PACKET
-        double power; // The strength of the transmission
-        bool lost; // Boolean value set to true in case a stronger transmission comes and hides the current one
-        struct _pending_transmission* next; // Pointer to the next element in the list of pending transmissions
+        unsigned char next; // Index of the slot of the next element in the list of free slots
 }pending_transmission;
 
+/*
+ * BROADCAST BUFFER DEPTH
+ *
+ * Number of frames of each node kept in the broadcast buffer (see "broadcast_frame"): a slot is reused by the node only
+ * when the transmission it holds has been committed, i.e. its time is below the GVT. If a node transmits more frames
+ * than this while it's ahead of the GVT, the frames that don't fit in the buffer are copied in the events
+ */
+
+#ifndef BROADCAST_BUFFER_DEPTH
+#define BROADCAST_BUFFER_DEPTH 64
+#endif
+
+/*
+ * BROADCAST FRAME
+ *
+ * A slot of the broadcast buffer, shared by all the nodes: when a node transmits a frame, it stores it once in its own
+ * slots of the buffer and sends to each node connected to it just a reference to the slot (see "transmission_reference"),
+ * rather than a copy of the whole frame.
+ * Only the node owning the slot writes it, while the receivers of the frame read it when the transmission starts
+ */
+
+typedef struct _broadcast_frame{
+
+        /*
+         * The frame transmitted: it's either "ctp_data_packet" or "ctp_routing_packet"
+         */
+
+        union transmission_frame frame;
+
+        /*
+         * Sequence number of the transmission of the frame (UINT_MAX while the slot is empty or being written)
+         */
+
+        unsigned int seq;
+}broadcast_frame;
+
+/*
+ * TRANSMISSION REFERENCE
+ *
+ * Content of the events TRANSMISSION_BEACON_STARTED and TRANSMISSION_DATA_PACKET_STARTED: it identifies the frame
+ * transmitted in the broadcast buffer and it carries the values of the transmission that depend on the receiver.
+ * Only the fields before "frame" are sent (TRANSMISSION_REFERENCE_SIZE bytes), unless the frame could not be stored in
+ * the broadcast buffer: in that case the whole structure is sent, with a copy of the frame
+ */
+
+typedef struct _transmission_reference{
+        unsigned int sender; // ID of the node that sent the frame
+        unsigned int seq; // Sequence number of the transmission, local to the sender
+        double gain_mw; // Gain of the link from the sender to the receiver, in mW
+        double duration; // Duration of the transmission
+        union transmission_frame frame; // The frame transmitted, if it is not in the broadcast buffer
+}transmission_reference;
+
+#ifndef TRANSMISSION_REFERENCE_SIZE
+#define TRANSMISSION_REFERENCE_SIZE offsetof(transmission_reference,frame)
+#endif
+
 /*
  * STATISTICS
  *
@@ -327,13 +468,55 @@ typedef struct _node_state{
 
         /* RADIO FIELDS - start */
 
+        /*
+         * PENDING TRANSMISSIONS POOL
+         *
+         * An array of "pending_transmissions_pool_size" slots, each one able to hold the frame of a pending
+         * transmission: the free slots are linked in a list through their "next" field
+         */
+
+        pending_transmission* pending_transmissions_pool;
+
+        /*
+         * IN-FLIGHT TRANSMISSIONS
+         *
+         * The incoming transmissions, stored as parallel arrays whose first "pending_transmissions" elements are used:
+         * they are sorted by the time when the transmissions finish, so the first one is always the next to finish.
+         * For each transmission, the arrays hold the strength of its signal (in mW), the time when it finishes, whether
+         * it has been hidden by a stronger transmission and the slot of the pool holding its frame: the strengths are
+         * contiguous, so they can all be compared against a new signal with a few vector instructions.
+         * Each array has "pending_transmissions_pool_size" elements
+         */
+
+        double* pending_transmissions_powers;
+        simtime_t* pending_transmissions_ends;
+        unsigned char* pending_transmissions_lost;
+        unsigned char* pending_transmissions_slots;
+
         /*
          * PENDING TRANSMISSIONS
          *
-         * This is the pointer to the first element of a list that keeps track of all the incoming transmissions
+         * Number of incoming transmissions, i.e. of used elements of the arrays of the in-flight transmissions
          */
 
-        pending_transmission* pending_transmissions;
+        unsigned char pending_transmissions;
+
+        /*
+         * FREE PENDING TRANSMISSIONS
+         *
+         * Index of the first free slot of the pool (NO_PENDING_TRANSMISSION if all the slots are used)
+         */
+
+        unsigned char free_pending_transmissions;
+
+        /*
+         * TRANSMISSION SEQUENCE NUMBER
+         *
+         * Sequence number of the next frame transmitted by the node, incremented by one at every transmission: it's used
+         * to tell apart all the transmissions of the node, even the ones carrying identical frames
+         */
+
+        unsigned int transmission_sequence_number;
 
         /*
          * PENDING TRANSMISSIONS POWER
@@ -348,6 +531,18 @@ typedef struct _node_state{
 
         double pending_transmissions_power;
 
+        /*
+         * NOISE HISTORY
+         *
+         * If the noise is taken from a trace, the last samples of the noise sensed by the node (as indexes of the
+         * values of the trace), stored in a circular buffer starting at "noise_history_position", and the hash of the
+         * sequence of samples (see "noise_model.c")
+         */
+
+        unsigned char noise_history[NOISE_HISTORY_SIZE];
+        unsigned char noise_history_position;
+        uint64_t noise_history_hash;
+
         /*
          * Bit-wise OR combinations of flags indicating the actual state of the radio transceiver (whether it is busy
          * transmitting or receiving frames)
@@ -376,11 +571,11 @@ typedef struct _node_state{
         /*
          * LINK ESTIMATOR TABLE
          *
-         * An array of link_estimator_table_entry with a number of NEIGHBOR_TABLE_SIZE elements: each entry corresponds
-         * to a neighbor node
+         * An array of link_estimator_table_entry with a number of "neighbor_table_size" elements: each entry
+         * corresponds to a neighbor node. It's stored in the tables of the node (see "allocate_node_tables")
          */
 
-        link_estimator_table_entry link_estimator_table[NEIGHBOR_TABLE_SIZE];
+        link_estimator_table_entry* link_estimator_table;
 
         /*
          * BEACON SEQUENCE NUMBER
@@ -419,14 +614,26 @@ typedef struct _node_state{
         /*
          * ROUTING TABLE
          *
-         * An array of routing_table_entry with a number of ROUTING_TABLE_SIZE elements, each corresponding to a
+         * An array of routing_table_entry with a number of "routing_table_size" elements, each corresponding to a
          * neighbor node => the routing engine maintains for each the value of ETX and selects the one with the lowest
-         * value as parent
+         * value as parent. It's stored in the tables of the node (see "allocate_node_tables")
          */
 
-        routing_table_entry routing_table[ROUTING_TABLE_SIZE];
+        routing_table_entry* routing_table;
         unsigned char neighbors; // Number of active entries in the routing table
 
+        /*
+         * CANDIDATE PARENTS
+         *
+         * Binary heap with the indexes of the entries of the routing table that can be selected as parent, ordered by
+         * the ETX of the route through them: the best candidate is always the first one. It has "routing_table_size"
+         * elements and it's stored in the tables of the node (see "allocate_node_tables")
+         */
+
+        unsigned char* parent_candidates;
+        unsigned char parent_candidates_count; // Number of entries in the heap of the candidate parents
+        unsigned char parent_entry; // Index of the entry of the routing table corresponding to the actual parent
+
         /* ROUTING ENGINE FIELDS - end */
 
         /* FORWARDING ENGINE FIELDS - start */
@@ -437,9 +644,10 @@ typedef struct _node_state{
          * When a data packet has to be forwarded, the node extracts one entry from this pool, initializes it to the
          * data of the data packet received and finally stores a pointer to the entry in the forwarding queue.
          *
-         * The pool is nothing more than fixed-size array, whose elements are of type "forwarding_queue_entry": in fact
-         * packets to be forwarded are stored in the same output queue as packets created by the node itself and as soon
-         * as they reach the head of the queue they are sent.
+         * The pool is nothing more than an array of "forwarding_pool_depth" elements of type "forwarding_queue_entry",
+         * stored in the tables of the node (see "allocate_node_tables"): in fact packets to be forwarded are stored in
+         * the same output queue as packets created by the node itself and as soon as they reach the head of the queue
+         * they are sent.
          *
          * An entry is taken from the pool using the "get" method and it is given back to the pool using the "put"
          * method: the entries are taken in order, according to their position, and are released in order.
@@ -450,7 +658,7 @@ typedef struct _node_state{
          * 2-forwarding_pool_index
          */
 
-        forwarding_queue_entry forwarding_pool[FORWARDING_POOL_DEPTH];
+        forwarding_queue_entry* forwarding_pool;
         unsigned char forwarding_pool_count; // Number of elements in the pool
         unsigned char forwarding_pool_index; // Index of the array where the next entry put will be collocated
 
@@ -459,7 +667,8 @@ typedef struct _node_state{
         /*
          * FORWARDING QUEUE - start
          *
-         * An array of elements of pointers to "forwarding_queue_entry" represents the output queue of the node; pointers
+         * An array of "forwarding_queue_depth" pointers to "forwarding_queue_entry", stored in the tables of the node
+         * (see "allocate_node_tables"), represents the output queue of the node; pointers
          * refer to packets (actually entries) created by the node or packets (entries) received by other nodes
          * that have to be forwarded.
          *
@@ -480,7 +689,7 @@ typedef struct _node_state{
          * it is then dequeued
          */
 
-        forwarding_queue_entry* forwarding_queue[FORWARDING_QUEUE_DEPTH];
+        forwarding_queue_entry** forwarding_queue;
 
         unsigned char forwarding_queue_count; // The counter of the elements in the forwarding queue
         unsigned char forwarding_queue_head; // The index of the first element in the queue (least recently added)
@@ -491,8 +700,9 @@ typedef struct _node_state{
         /*
          * OUTPUT CACHE - start
          *
-         * An array of pointers to data packets represents the output LRU (Least Recently Used )cache of the node, where
-         * are stored the most recently packets sent by the node => it's used to avoid forwarding the same packet twice.
+         * An array of "cache_size" data packets, stored in the tables of the node (see "allocate_node_tables"),
+         * represents the output LRU (Least Recently Used )cache of the node, where are stored the most recently packets
+         * sent by the node => it's used to avoid forwarding the same packet twice.
          *
          * NOTE it is assumed that the node does not produce duplicates on its own => duplicates only regard packets to
          * be forwarded; usually they are caused by not acknowledged packets
@@ -514,7 +724,7 @@ typedef struct _node_state{
          * least recently used is removed
          */
 
-        ctp_data_packet output_cache[CACHE_SIZE];
+        ctp_data_packet* output_cache;
 
         unsigned char output_cache_count; // Number of sent data packets cached
         unsigned char output_cache_first; // Index of the entry in the cache that was least recently added
@@ -556,9 +766,19 @@ typedef struct _node_state{
         unsigned int me; // ID of this node (logical process)
         unsigned char state; // Bit-wise OR combination of flags indicating the state of the node
         simtime_t lvt; // Value of the Local Virtual Time
+
+        /*
+         * Generation of each timer of the node: it's increased every time the timer is started or stopped, and a
+         * firing of the timer is processed only if it carries the current generation
+         */
+
+        unsigned int timer_generations[TIMERS_COUNT];
 } node_state;
 
 void wait_until(unsigned int me,simtime_t timestamp,unsigned int type);
+void start_timer(node_state* state,unsigned int timer,simtime_t timestamp,unsigned int type);
+void stop_timer(node_state* state,unsigned int timer);
+bool is_timer_current(node_state* state,unsigned int timer,void* event_content,unsigned int size);
 void collected_data_packet(ctp_data_packet* packet);
 
 #endif
\ No newline at end of file
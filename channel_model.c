@@ -0,0 +1,758 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include "channel_model.h"
+#include "power_conversion.h"
+#include "physical_layer.h"
+
+/*
+ * CHANNEL MODEL
+ *
+ * Procedural model of the wireless channel, alternative to the input file: rather than reading the gain of all the
+ * n*(n-1) links of the network, the simulation reads the coordinates of the nodes (the file "topology.out" created by
+ * LinkLayerModel.java) and computes the gain of a link when it's needed, with the same log-normal shadowing model used
+ * by LinkLayerModel.java:
+ *
+ * gain=-PL_D0-10*PATH_LOSS_EXPONENT*log10(d/D0)+shadowing
+ *
+ * where d is the distance between the nodes and the shadowing is a gaussian random variable with mean 0 and standard
+ * deviation SHADOWING_STANDARD_DEVIATION. As in LinkLayerModel.java, the shadowing of a link is the same in both the
+ * directions.
+ * The shadowing is not drawn from the random number generator of the simulator: it's computed from a hash of the IDs of
+ * the nodes of the link and of the seed SHADOWING_SEED, so the gain of a link is always the same, no matter which node
+ * computes it, when, or how many times => the memory needed is proportional to the number of nodes, while the results
+ * are reproducible.
+ * All the nodes share the same noise floor and range of the white gaussian noise, given as parameters.
+ */
+
+/* GLOBAL VARIABLES - start
+ *
+ * Default values of the parameters for the channel model (check channel_model.h for a description)
+ */
+
+double path_loss_exponent=PATH_LOSS_EXPONENT;
+double shadowing_standard_deviation=SHADOWING_STANDARD_DEVIATION;
+double pl_d0=PL_D0;
+double d0=D0;
+double noise_floor=NOISE_FLOOR;
+double white_gaussian_noise=WHITE_GAUSSIAN_NOISE;
+unsigned long shadowing_seed=SHADOWING_SEED;
+double shadowing_clamp=SHADOWING_CLAMP;
+unsigned int gain_cache_size=GAIN_CACHE_SIZE;
+
+/* GLOBAL VARIABLES - end */
+
+/*
+ * PROCEDURAL CHANNEL
+ *
+ * Boolean value telling whether the gains of the links are computed from the coordinates of the nodes, rather than
+ * read from the input file
+ */
+
+bool procedural_channel=false;
+
+/*
+ * COORDINATES LIST
+ *
+ * Dynamically allocated array containing the coordinates of each node, indexed by the ID of the node
+ */
+
+node_coordinates* coordinates_list=NULL;
+
+/*
+ * GAIN CACHE
+ *
+ * Dynamically allocated array of "gain_cache_size" entries for each node, where the node stores the gains of the
+ * links towards the nodes it transmits to: the gain of the link towards node "j" is stored in the entry
+ * j%gain_cache_size of the node. Each node only accesses its own entries, when it transmits a frame
+ */
+
+gain_cache_entry* gain_cache=NULL;
+
+/*
+ * MEAN SHADOWING GAIN
+ *
+ * Mean value of the shadowing of a link in linear units, i.e. the ratio between the mean power of the links of a given
+ * length and the power at the median (see "compute_mean_shadowing_gain"): it's computed once, when the parameters are
+ * parsed
+ */
+
+double mean_shadowing_gain=1.0;
+
+/*
+ * GRID ENABLED
+ *
+ * Boolean value telling whether the spatial grid is used to find the nodes a transmission is delivered to: this is the
+ * case if the topology is sparse or the far field is aggregated, and the audible radius is smaller than the area where
+ * the nodes are placed
+ */
+
+bool grid_enabled=false;
+
+/*
+ * GRID
+ *
+ * Spatial grid of the nodes (see "build_spatial_grid")
+ */
+
+spatial_grid grid;
+
+extern noise_entry* noise_list;
+extern bool sparse_topology;
+extern bool far_field_aggregation;
+
+/*
+ * COMPUTE MEAN SHADOWING GAIN
+ *
+ * Return the mean value of 10^(S/10), where the shadowing S (in dB) is sigma*Z, with Z a standard gaussian variable cut
+ * at +-c (see "get_shadowing"), sigma=shadowing_standard_deviation and c=shadowing_clamp. With a=sigma*ln(10)/10:
+ *
+ * E[e^(a*Z)]=e^(a^2/2)*(PHI(c-a)-PHI(-c-a))+(e^(a*c)+e^(-a*c))*PHI(-c)
+ *
+ * where PHI is the cumulative distribution function of Z: the first term covers the values within the clamp, the
+ * second one the values set to +-c. Without the clamp it would be e^(a^2/2), about 1.8 dB with the default deviation
+ */
+
+static double compute_mean_shadowing_gain(){
+
+        /*
+         * Deviation of the shadowing in natural logarithm units
+         */
+
+        double a=shadowing_standard_deviation*M_LN10/10;
+
+        /*
+         * Probability that the shadowing is set to the clamp on each side, PHI(-c)=erfc(c/sqrt(2))/2
+         */
+
+        double tail=0.5*erfc(shadowing_clamp*M_SQRT1_2);
+
+        return exp(a*a/2)*0.5*(erfc(-(shadowing_clamp-a)*M_SQRT1_2)-erfc((shadowing_clamp+a)*M_SQRT1_2))+
+               (exp(a*shadowing_clamp)+exp(-a*shadowing_clamp))*tail;
+}
+
+/*
+ * PARSE SIMULATION PARAMETERS FOR THE CHANNEL MODEL
+ */
+
+void parse_channel_model_parameters(void* event_content){
+
+        if(IsParameterPresent(event_content, "path_loss_exponent"))
+                path_loss_exponent=GetParameterDouble(event_content,"path_loss_exponent");
+        if(IsParameterPresent(event_content, "shadowing_standard_deviation"))
+                shadowing_standard_deviation=GetParameterDouble(event_content,"shadowing_standard_deviation");
+        if(IsParameterPresent(event_content, "pl_d0"))
+                pl_d0=GetParameterDouble(event_content,"pl_d0");
+        if(IsParameterPresent(event_content, "d0"))
+                d0=GetParameterDouble(event_content,"d0");
+        if(IsParameterPresent(event_content, "noise_floor"))
+                noise_floor=GetParameterDouble(event_content,"noise_floor");
+        if(IsParameterPresent(event_content, "white_gaussian_noise"))
+                white_gaussian_noise=GetParameterDouble(event_content,"white_gaussian_noise");
+        if(IsParameterPresent(event_content, "shadowing_seed"))
+                shadowing_seed=(unsigned long)GetParameterInt(event_content,"shadowing_seed");
+        if(IsParameterPresent(event_content, "shadowing_clamp"))
+                shadowing_clamp=GetParameterDouble(event_content,"shadowing_clamp");
+        if(IsParameterPresent(event_content, "gain_cache_size"))
+                gain_cache_size=(unsigned int)GetParameterInt(event_content,"gain_cache_size");
+
+        /*
+         * Check the values of the parameters, as LinkLayerModel.java does: if not valid, abort
+         */
+
+        if(path_loss_exponent<0 || shadowing_standard_deviation<0 || pl_d0<0 || d0<=0 || white_gaussian_noise<0 ||
+           shadowing_clamp<0){
+                printf("[FATAL ERROR] The parameters of the channel model are not valid: path_loss_exponent, "
+                               "shadowing_standard_deviation, pl_d0, white_gaussian_noise and shadowing_clamp have to "
+                               "be positive, d0 greater than zero\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * The shadowing only depends on the parameters => compute its mean value once
+         */
+
+        mean_shadowing_gain=compute_mean_shadowing_gain();
+}
+
+/*
+ * READ COORDINATES FILE
+ *
+ * Read the coordinates of the nodes from the given file, which has the syntax of the file "topology.out" created by
+ * LinkLayerModel.java:
+ *
+ * node_id\t x\t y\n
+ *
+ * Since LinkLayerModel.java may print the coordinates with the decimal separator of the current locale, a comma is
+ * accepted as decimal separator as well. Each of the n nodes has to be given its coordinates, otherwise the simulation
+ * is aborted.
+ * Then the noise of all the nodes is set and the cache of the gains is allocated: from now on, the gains of the links
+ * are computed from the coordinates
+ *
+ * @path: filename of the file
+ */
+
+void read_coordinates_file(const char* path){
+
+        /*
+         * Number of current line read from the file
+         */
+
+        unsigned int lines=0;
+
+        /*
+         * Buffer for the line and its size, allocated by "getline"
+         */
+
+        size_t len=0;
+        char* lineptr=NULL;
+
+        /*
+         * Flag for each node telling whether its coordinates have been read
+         */
+
+        bool* coordinates_read;
+
+        /*
+         * Index variables
+         */
+
+        unsigned int node;
+        unsigned long entry;
+
+        /*
+         * Open the file
+         */
+
+        FILE* coordinates_file=fopen(path,"r");
+        if(!coordinates_file){
+                printf("[FATAL ERROR] Provided path doesn't correspond to any file or it cannot be accessed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Allocate the coordinates of the nodes, the flags and the noise of the nodes
+         */
+
+        coordinates_list=malloc(sizeof(node_coordinates)*n_prc_tot);
+        coordinates_read=calloc(n_prc_tot,sizeof(bool));
+        noise_list=malloc(sizeof(noise_entry)*n_prc_tot);
+        if(!coordinates_list || !coordinates_read || !noise_list){
+                printf("[FATAL ERROR] Not enough memory to store the coordinates of the nodes\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Read the file line by line
+         */
+
+        while(getline(&lineptr,&len,coordinates_file)!=-1){
+
+                /*
+                 * Tokens of the line: the ID of the node and its coordinates
+                 */
+
+                char* tokens[3];
+
+                /*
+                 * Pointer to the comma in a token
+                 */
+
+                char* comma;
+
+                /*
+                 * Index variable
+                 */
+
+                unsigned short index;
+
+                lines++;
+
+                /*
+                 * Skip empty lines
+                 */
+
+                tokens[0]=strtok(lineptr," \t\r\n");
+                if(!tokens[0])
+                        continue;
+
+                /*
+                 * Get the coordinates, replacing the comma with a dot
+                 */
+
+                for(index=1;index<3;index++){
+                        tokens[index]=strtok(NULL," \t\r\n");
+                        if(!tokens[index]){
+                                printf("[FATAL ERROR] Line %u of the coordinates file is not well formed\n",lines);
+                                exit(EXIT_FAILURE);
+                        }
+                        comma=strchr(tokens[index],',');
+                        if(comma)
+                                *comma='.';
+                }
+
+                /*
+                 * Parse the line: the ID has to correspond to a node of the simulation
+                 */
+
+                if(sscanf(tokens[0],"%u",&node)!=1 || node>=n_prc_tot ||
+                   sscanf(tokens[1],"%lf",&coordinates_list[node].x)!=1 ||
+                   sscanf(tokens[2],"%lf",&coordinates_list[node].y)!=1){
+                        printf("[FATAL ERROR] Line %u of the coordinates file is not well formed\n",lines);
+                        exit(EXIT_FAILURE);
+                }
+                coordinates_read[node]=true;
+        }
+        free(lineptr);
+        fclose(coordinates_file);
+
+        /*
+         * Check that every node has its coordinates and set its noise
+         */
+
+        for(node=0;node<n_prc_tot;node++){
+                if(!coordinates_read[node]){
+                        printf("[FATAL ERROR] Coordinates for node %u are not given\n",node);
+                        exit(EXIT_FAILURE);
+                }
+                noise_list[node].noise_floor=noise_floor;
+                noise_list[node].range=white_gaussian_noise;
+        }
+        free(coordinates_read);
+
+        /*
+         * Allocate the cache of the gains, with all the entries empty
+         */
+
+        if(gain_cache_size){
+                gain_cache=malloc(sizeof(gain_cache_entry)*n_prc_tot*gain_cache_size);
+                if(!gain_cache){
+                        printf("[FATAL ERROR] Not enough memory to store the cache of the gains\n");
+                        exit(EXIT_FAILURE);
+                }
+                for(entry=0;entry<(unsigned long)n_prc_tot*gain_cache_size;entry++)
+                        gain_cache[entry].sink=UINT_MAX;
+        }
+
+        procedural_channel=true;
+
+        /*
+         * If the topology is sparse or the far field is aggregated, the transmissions of a node are only delivered to
+         * the nodes close to it => index the nodes by their position
+         */
+
+        if(sparse_topology || far_field_aggregation)
+                build_spatial_grid();
+}
+
+/*
+ * HASH
+ *
+ * Mix the bits of a 64-bit value (finalizer of the SplitMix64 generator): every bit of the result depends on every bit
+ * of the input
+ *
+ * @value: the value
+ */
+
+static uint64_t hash(uint64_t value){
+        value=(value^(value>>30))*0xbf58476d1ce4e5b9ULL;
+        value=(value^(value>>27))*0x94d049bb133111ebULL;
+        return value^(value>>31);
+}
+
+/*
+ * GET SHADOWING
+ *
+ * Return the shadowing of the link between the two given nodes (in dB): it's the same in both the directions.
+ * Two independent uniform values are drawn from the hash of the IDs of the nodes and of the seed, then they are turned
+ * into a gaussian value by the Box-Muller transform
+ *
+ * @first: ID of one of the nodes of the link
+ * @second: ID of the other node of the link
+ */
+
+static double get_shadowing(unsigned int first,unsigned int second){
+
+        /*
+         * Key of the link: the IDs of the nodes, the lowest one first
+         */
+
+        uint64_t key=first<second?((uint64_t)first<<32|second):((uint64_t)second<<32|first);
+
+        /*
+         * Two hash values of the key, each one depending on the seed
+         */
+
+        uint64_t first_hash=hash(key^hash(shadowing_seed));
+        uint64_t second_hash=hash(first_hash^0x9e3779b97f4a7c15ULL);
+
+        /*
+         * Two uniform values from the 53 highest bits of the hash values: the first one in (0,1], the second one in
+         * [0,1)
+         */
+
+        double first_uniform=((first_hash>>11)+1)*(1.0/9007199254740992.0);
+        double second_uniform=(second_hash>>11)*(1.0/9007199254740992.0);
+
+        /*
+         * Gaussian value, cut at "shadowing_clamp" standard deviations
+         */
+
+        double gaussian=sqrt(-2.0*log(first_uniform))*cos(2.0*M_PI*second_uniform);
+        if(gaussian>shadowing_clamp)
+                gaussian=shadowing_clamp;
+        if(gaussian<-shadowing_clamp)
+                gaussian=-shadowing_clamp;
+
+        return gaussian*shadowing_standard_deviation;
+}
+
+/*
+ * COMPUTE PATH GAIN
+ *
+ * Compute the gain (in dBm) of a link as long as the given distance, without the shadowing: it's the median gain of the
+ * links of that length (their mean gain in dBm)
+ *
+ * @distance: length of the link (in meters)
+ */
+
+double compute_path_gain(double distance){
+
+        /*
+         * Distance relative to the reference distance: nodes closer than the reference distance are regarded as being
+         * at the reference distance
+         */
+
+        distance/=d0;
+        if(distance<1.0)
+                distance=1.0;
+
+        /*
+         * Return the gain: 10*log10(distance) is the value of the distance "in dBm"
+         */
+
+        return -pl_d0-path_loss_exponent*mw_to_dbm(distance);
+}
+
+/*
+ * COMPUTE LINK GAIN
+ *
+ * Compute the gain (in dBm) of the link between the given nodes from their distance and the shadowing of the link
+ *
+ * @source: ID of the source node of the link
+ * @sink: ID of the sink node of the link
+ */
+
+double compute_link_gain(unsigned int source,unsigned int sink){
+
+        /*
+         * Distance between the nodes along the two axes
+         */
+
+        double x_distance=coordinates_list[source].x-coordinates_list[sink].x;
+        double y_distance=coordinates_list[source].y-coordinates_list[sink].y;
+
+        return compute_path_gain(sqrt(x_distance*x_distance+y_distance*y_distance))+get_shadowing(source,sink);
+}
+
+/*
+ * GET LINK GAIN
+ *
+ * Get the gain of the link between the given nodes, both in dBm and in mW: it's taken from the cache of the source node,
+ * if there, otherwise it's computed and stored in the cache.
+ * This has to be called only by the source node of the link
+ *
+ * @source: ID of the source node of the link
+ * @sink: ID of the sink node of the link
+ * @gain: pointer to the variable where the gain in dBm is stored
+ * @gain_mw: pointer to the variable where the gain in mW is stored
+ */
+
+void get_link_gain(unsigned int source,unsigned int sink,double* gain,double* gain_mw){
+
+        /*
+         * Pointer to the entry of the cache for the link
+         */
+
+        gain_cache_entry* entry;
+
+        /*
+         * If the cache is disabled, just compute the gain
+         */
+
+        if(!gain_cache_size){
+                *gain=compute_link_gain(source,sink);
+                *gain_mw=dbm_to_mw(*gain);
+                return;
+        }
+
+        /*
+         * If the entry doesn't hold the link, compute its gain and store it in the entry
+         */
+
+        entry=&gain_cache[(unsigned long)source*gain_cache_size+sink%gain_cache_size];
+        if(entry->sink!=sink){
+                entry->sink=sink;
+                entry->gain=compute_link_gain(source,sink);
+                entry->gain_mw=dbm_to_mw(entry->gain);
+        }
+
+        *gain=entry->gain;
+        *gain_mw=entry->gain_mw;
+}
+
+/*
+ * GET CELL
+ *
+ * Return the column and the row of the cell of the spatial grid containing the given node
+ *
+ * @node: ID of the node
+ * @column: pointer to the variable where the column is stored
+ * @row: pointer to the variable where the row is stored
+ */
+
+static void get_cell(unsigned int node,unsigned int* column,unsigned int* row){
+        *column=(unsigned int)((coordinates_list[node].x-grid.min_x)/grid.cell_size);
+        *row=(unsigned int)((coordinates_list[node].y-grid.min_y)/grid.cell_size);
+        if(*column>=grid.columns)
+                *column=grid.columns-1;
+        if(*row>=grid.rows)
+                *row=grid.rows-1;
+}
+
+/*
+ * BUILD SPATIAL GRID
+ *
+ * Compute the audible radius, i.e. the highest distance at which a transmission can be delivered, and index the nodes
+ * by their position in a uniform grid whose cells are not smaller than the radius.
+ * A transmission is delivered if the gain of its link is not below the cutoff of the sink node (see
+ * "get_delivery_cutoff"): the gain is at most -pl_d0-10*path_loss_exponent*log10(d/d0)+
+ * shadowing_clamp*shadowing_standard_deviation, so the radius is the distance at which this value equals the lowest
+ * cutoff of the nodes.
+ * If the radius is not shorter than the diagonal of the area where the nodes are placed, any node can hear any other
+ * one and the grid is not used. The number of cells is kept below four times the number of nodes, making the cells
+ * larger if needed.
+ * The coordinates and the noise of the nodes, as well as the parameters of the physical layer, have to be known when
+ * this function is invoked
+ */
+
+void build_spatial_grid(){
+
+        /*
+         * Lowest cutoff of the nodes and highest gain of a link at the reference distance
+         */
+
+        double lowest_cutoff=get_delivery_cutoff(0);
+        double highest_gain=-pl_d0+shadowing_clamp*shadowing_standard_deviation;
+
+        /*
+         * Highest coordinates of the nodes
+         */
+
+        double max_x=coordinates_list[0].x;
+        double max_y=coordinates_list[0].y;
+
+        /*
+         * Position of the next node of each cell in the array of the nodes
+         */
+
+        unsigned int* next_position;
+
+        /*
+         * Index variables
+         */
+
+        unsigned int node;
+        unsigned int cell;
+        unsigned int column;
+        unsigned int row;
+
+        /*
+         * Get the lowest cutoff and the area where the nodes are placed
+         */
+
+        grid.min_x=coordinates_list[0].x;
+        grid.min_y=coordinates_list[0].y;
+        for(node=1;node<n_prc_tot;node++){
+                if(get_delivery_cutoff(node)<lowest_cutoff)
+                        lowest_cutoff=get_delivery_cutoff(node);
+                if(coordinates_list[node].x<grid.min_x)
+                        grid.min_x=coordinates_list[node].x;
+                if(coordinates_list[node].x>max_x)
+                        max_x=coordinates_list[node].x;
+                if(coordinates_list[node].y<grid.min_y)
+                        grid.min_y=coordinates_list[node].y;
+                if(coordinates_list[node].y>max_y)
+                        max_y=coordinates_list[node].y;
+        }
+
+        /*
+         * If the path loss doesn't depend on the distance, any node can hear any other one => don't use the grid
+         */
+
+        if(path_loss_exponent<=0)
+                return;
+
+        /*
+         * Compute the radius: 10*log10(d/d0)=(highest_gain-lowest_cutoff)/path_loss_exponent, i.e. d/d0 is the value in
+         * mW corresponding to this value in dBm. Nodes closer than d0 are regarded as being at d0
+         */
+
+        grid.radius=d0*dbm_to_mw((highest_gain-lowest_cutoff)/path_loss_exponent);
+        if(grid.radius<d0)
+                grid.radius=d0;
+
+        /*
+         * If the radius covers the whole area, don't use the grid
+         */
+
+        if(grid.radius*grid.radius>=(max_x-grid.min_x)*(max_x-grid.min_x)+(max_y-grid.min_y)*(max_y-grid.min_y))
+                return;
+
+        /*
+         * Choose the size of the cells: at least the radius, but doubled until there are less than four cells for each
+         * node
+         */
+
+        grid.cell_size=grid.radius;
+        while(((max_x-grid.min_x)/grid.cell_size+1)*((max_y-grid.min_y)/grid.cell_size+1)>4.0*n_prc_tot)
+                grid.cell_size*=2;
+        grid.columns=(unsigned int)((max_x-grid.min_x)/grid.cell_size)+1;
+        grid.rows=(unsigned int)((max_y-grid.min_y)/grid.cell_size)+1;
+
+        /*
+         * Allocate the arrays of the grid
+         */
+
+        grid.offsets=calloc((unsigned long)grid.columns*grid.rows+1,sizeof(unsigned int));
+        grid.nodes=malloc(sizeof(unsigned int)*n_prc_tot);
+        next_position=malloc(sizeof(unsigned int)*grid.columns*grid.rows);
+        if(!grid.offsets || !grid.nodes || !next_position){
+                printf("[FATAL ERROR] Not enough memory to store the spatial grid of the nodes\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Count the nodes of each cell, storing the count in the offset of the next cell
+         */
+
+        for(node=0;node<n_prc_tot;node++){
+                get_cell(node,&column,&row);
+                grid.offsets[row*grid.columns+column+1]++;
+        }
+
+        /*
+         * Turn the counts into offsets
+         */
+
+        for(cell=0;cell<grid.columns*grid.rows;cell++){
+                grid.offsets[cell+1]+=grid.offsets[cell];
+                next_position[cell]=grid.offsets[cell];
+        }
+
+        /*
+         * Store the IDs of the nodes, grouped by cell
+         */
+
+        for(node=0;node<n_prc_tot;node++){
+                get_cell(node,&column,&row);
+                grid.nodes[next_position[row*grid.columns+column]++]=node;
+        }
+        free(next_position);
+
+        grid_enabled=true;
+}
+
+/*
+ * GET NEIGHBOUR CELLS
+ *
+ * Store in the given array the cells of the spatial grid where the nodes that can hear a transmission of the given
+ * node are: the cell of the node and the ones around it (at most nine cells)
+ *
+ * @node: ID of the node
+ * @cells: array of at least nine elements where the indexes of the cells are stored
+ *
+ * Returns the number of cells stored
+ */
+
+unsigned int get_neighbour_cells(unsigned int node,unsigned int* cells){
+
+        /*
+         * Cell of the node
+         */
+
+        unsigned int column;
+        unsigned int row;
+
+        /*
+         * Cell around the node
+         */
+
+        unsigned int neighbour_column;
+        unsigned int neighbour_row;
+
+        /*
+         * Number of cells stored
+         */
+
+        unsigned int count=0;
+
+        get_cell(node,&column,&row);
+
+        /*
+         * Store the cells in the 3x3 square centered on the cell of the node, skipping the ones out of the grid
+         */
+
+        for(neighbour_row=row?row-1:0;neighbour_row<=row+1 && neighbour_row<grid.rows;neighbour_row++){
+                for(neighbour_column=column?column-1:0;neighbour_column<=column+1 && neighbour_column<grid.columns;
+                    neighbour_column++)
+                        cells[count++]=neighbour_row*grid.columns+neighbour_column;
+        }
+        return count;
+}
+
+/*
+ * GET CELL DISTANCE
+ *
+ * Return the distance (in meters) between the given node and the center of the given cell of the spatial grid
+ *
+ * @node: ID of the node
+ * @cell: index of the cell
+ */
+
+double get_cell_distance(unsigned int node,unsigned int cell){
+
+        /*
+         * Distance between the node and the center of the cell along the two axes
+         */
+
+        double x_distance=grid.min_x+(cell%grid.columns+0.5)*grid.cell_size-coordinates_list[node].x;
+        double y_distance=grid.min_y+(cell/grid.columns+0.5)*grid.cell_size-coordinates_list[node].y;
+
+        return sqrt(x_distance*x_distance+y_distance*y_distance);
+}
+
+/*
+ * IS WITHIN AUDIBLE RADIUS
+ *
+ * Tell whether the distance between the given nodes is not above the audible radius: if it is, the transmissions of
+ * the source node are not delivered to the sink node, whatever the shadowing of the link
+ *
+ * @source: ID of the source node
+ * @sink: ID of the sink node
+ */
+
+bool is_within_audible_radius(unsigned int source,unsigned int sink){
+
+        /*
+         * Distance between the nodes along the two axes
+         */
+
+        double x_distance=coordinates_list[source].x-coordinates_list[sink].x;
+        double y_distance=coordinates_list[source].y-coordinates_list[sink].y;
+
+        return x_distance*x_distance+y_distance*y_distance<=grid.radius*grid.radius;
+}
@@ -0,0 +1,135 @@
+#ifndef SENSORSNETWORKMODELPROJECT_CHANNEL_MODEL_H
+#define SENSORSNETWORKMODELPROJECT_CHANNEL_MODEL_H
+
+#include <stdbool.h>
+#include "application.h"
+
+/*
+ * CHANNEL MODEL PARAMETERS' DEFAULT VALUES
+ *
+ * They are used only if the coordinates of the nodes are given instead of the input file (see "channel_model.c"): the
+ * names and the default values are the same as the ones of the configuration file of LinkLayerModel.java
+ */
+
+/*
+ * Exponent of the path loss: the higher the exponent, the faster the signal decays with the distance
+ */
+
+#ifndef PATH_LOSS_EXPONENT
+#define PATH_LOSS_EXPONENT 3.0
+#endif
+
+/*
+ * Standard deviation (in dB) of the log-normal shadowing of the links
+ */
+
+#ifndef SHADOWING_STANDARD_DEVIATION
+#define SHADOWING_STANDARD_DEVIATION 4.0
+#endif
+
+/*
+ * Path loss (in dB) at the reference distance D0
+ */
+
+#ifndef PL_D0
+#define PL_D0 55.4
+#endif
+
+/*
+ * Reference distance (in meters): nodes closer than this are regarded as being at this distance
+ */
+
+#ifndef D0
+#define D0 1.0
+#endif
+
+/*
+ * Noise floor (in dBm) and range of the white gaussian noise (in dBm) of all the nodes
+ */
+
+#ifndef NOISE_FLOOR
+#define NOISE_FLOOR -105.0
+#endif
+
+#ifndef WHITE_GAUSSIAN_NOISE
+#define WHITE_GAUSSIAN_NOISE 4.0
+#endif
+
+/*
+ * Seed of the shadowing: the shadowing of a link only depends on this value and on the IDs of the nodes of the link
+ */
+
+#ifndef SHADOWING_SEED
+#define SHADOWING_SEED 0
+#endif
+
+/*
+ * Highest absolute value of the shadowing, as a multiple of its standard deviation: the tails of the gaussian
+ * distribution are cut, so that the gain of the links at a given distance is bounded
+ */
+
+#ifndef SHADOWING_CLAMP
+#define SHADOWING_CLAMP 3.0
+#endif
+
+/*
+ * Number of gains of links cached by each node (0 disables the cache)
+ */
+
+#ifndef GAIN_CACHE_SIZE
+#define GAIN_CACHE_SIZE 0
+#endif
+
+/*
+ * NODE COORDINATES
+ *
+ * Position of a node, read from the file "topology.out" created by LinkLayerModel.java
+ */
+
+typedef struct _node_coordinates{
+        double x; // Coordinate along the X axis (in meters)
+        double y; // Coordinate along the Y axis (in meters)
+}node_coordinates;
+
+/*
+ * GAIN CACHE ENTRY
+ *
+ * Gain of a link from a node, stored in the cache of the node
+ */
+
+typedef struct _gain_cache_entry{
+        unsigned int sink; // ID of the sink node of the link (UINT_MAX if the entry is empty)
+        double gain; // Gain of the link (in dBm)
+        double gain_mw; // Gain of the link (in mW)
+}gain_cache_entry;
+
+/*
+ * SPATIAL GRID
+ *
+ * Uniform grid covering the area where the nodes are placed: the side of its cells is at least the audible radius, so
+ * the nodes that can hear a transmission are all in the cell of the sender or in the eight cells around it.
+ * The IDs of the nodes of each cell are stored contiguously, as the links of the gain table: those of cell "c" are in
+ * the range [offsets[c],offsets[c+1]) of the array "nodes"
+ */
+
+typedef struct _spatial_grid{
+        double min_x; // Lowest coordinate of the nodes along the X axis (in meters)
+        double min_y; // Lowest coordinate of the nodes along the Y axis (in meters)
+        double cell_size; // Side of the cells (in meters)
+        double radius; // Highest distance (in meters) at which a transmission can be heard
+        unsigned int columns; // Number of cells along the X axis
+        unsigned int rows; // Number of cells along the Y axis
+        unsigned int* offsets; // Position of the first node of each cell in the array of the nodes
+        unsigned int* nodes; // IDs of the nodes, grouped by cell
+}spatial_grid;
+
+void parse_channel_model_parameters(void* event_content);
+void read_coordinates_file(const char* path);
+double compute_path_gain(double distance);
+double compute_link_gain(unsigned int source,unsigned int sink);
+void get_link_gain(unsigned int source,unsigned int sink,double* gain,double* gain_mw);
+void build_spatial_grid();
+unsigned int get_neighbour_cells(unsigned int node,unsigned int* cells);
+double get_cell_distance(unsigned int node,unsigned int cell);
+bool is_within_audible_radius(unsigned int source,unsigned int sink);
+#endif //SENSORSNETWORKMODELPROJECT_CHANNEL_MODEL_H
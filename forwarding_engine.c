@@ -26,6 +26,7 @@
  * which is the time needed to repair the LOOP.
  */
 
+#include <limits.h>
 #include "application.h"
 #include "link_layer.h"
 
@@ -39,6 +40,9 @@ void cache_remove(unsigned char offset,node_state* state);
  * Default values of the parameters for the forwarding engine (check forwarding_engine.h for a description)
  */
 
+unsigned int forwarding_queue_depth=FORWARDING_QUEUE_DEPTH;
+unsigned int forwarding_pool_depth=FORWARDING_POOL_DEPTH;
+unsigned int cache_size=CACHE_SIZE;
 unsigned int max_retries=MAX_RETRIES;
 double data_packet_transmission_offset=DATA_PACKET_RETRANSMISSION_OFFSET;
 double data_packet_transmission_delta=DATA_PACKET_RETRANSMISSION_DELTA;
@@ -59,6 +63,12 @@ extern node_statistics* node_statistics_list;
 
 void parse_forwarding_engine_parameters(void* event_content) {
 
+        if (IsParameterPresent(event_content, "forwarding_queue_depth"))
+                forwarding_queue_depth = (unsigned int) GetParameterInt(event_content, "forwarding_queue_depth");
+        if (IsParameterPresent(event_content, "forwarding_pool_depth"))
+                forwarding_pool_depth = (unsigned int) GetParameterInt(event_content, "forwarding_pool_depth");
+        if (IsParameterPresent(event_content, "cache_size"))
+                cache_size = (unsigned int) GetParameterInt(event_content, "cache_size");
         if (IsParameterPresent(event_content, "max_retries"))
                 max_retries = (unsigned int) GetParameterInt(event_content, "max_retries");
         if (IsParameterPresent(event_content, "data_packet_transmission_offset"))
@@ -75,6 +85,33 @@ void parse_forwarding_engine_parameters(void* event_content) {
                 min_payload = (unsigned int) GetParameterInt(event_content,"min_payload");
         if (IsParameterPresent(event_content, "max_payload"))
                 max_payload = (unsigned int) GetParameterInt(event_content,"max_payload");
+
+        /*
+         * The size of the forwarding queue has to fit the indexes used to scan it
+         */
+
+        if(!forwarding_queue_depth || forwarding_queue_depth>UCHAR_MAX){
+                printf("[FATAL ERROR] The size of the forwarding queue has to be between 1 and %d\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * The size of the forwarding pool has to fit the indexes used to scan it
+         */
+
+        if(!forwarding_pool_depth || forwarding_pool_depth>UCHAR_MAX){
+                printf("[FATAL ERROR] The size of the forwarding pool has to be between 1 and %d\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * The size of the output cache has to fit the indexes used to scan it
+         */
+
+        if(!cache_size || cache_size>UCHAR_MAX){
+                printf("[FATAL ERROR] The size of the output cache has to be between 1 and %d\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
 }
 
 /* FORWARDING POOL - start */
@@ -120,7 +157,7 @@ forwarding_queue_entry* forwarding_pool_get(node_state* state){
          * If "index" is now beyond the limit of the pool, set it to the first position
          */
 
-        if(state->forwarding_pool_index==FORWARDING_POOL_DEPTH)
+        if(state->forwarding_pool_index==forwarding_pool_depth)
                 state->forwarding_pool_index=0;
 
         /*
@@ -151,7 +188,7 @@ void forwarding_pool_put(forwarding_queue_entry* entry,node_state* state){
          * Check if the pool is full: an entry can be added only if not full
          */
 
-        if(state->forwarding_pool_count<FORWARDING_POOL_DEPTH){
+        if(state->forwarding_pool_count<forwarding_pool_depth){
 
                 /*
                  * Get the index of a free position in the pool where the entry can be stored
@@ -163,8 +200,8 @@ void forwarding_pool_put(forwarding_queue_entry* entry,node_state* state){
                  * If the index is beyond the limit of the pool, correct it
                  */
 
-                if(index>=FORWARDING_POOL_DEPTH)
-                        index-=FORWARDING_POOL_DEPTH;
+                if(index>=forwarding_pool_depth)
+                        index-=forwarding_pool_depth;
 
                 /*
                  * Put the given entry in the first free place
@@ -205,7 +242,7 @@ bool forwarding_queue_enqueue(forwarding_queue_entry* entry,node_state* state){
          * Check if there's free space in the queue
          */
 
-        if(state->forwarding_queue_count<FORWARDING_QUEUE_DEPTH){
+        if(state->forwarding_queue_count<forwarding_queue_depth){
 
                 /*
                  * There's enough space in the queue for at least one new element => insert the new element at position
@@ -232,7 +269,7 @@ bool forwarding_queue_enqueue(forwarding_queue_entry* entry,node_state* state){
                  * This is mandatory to implement the FIFO logic
                  */
 
-                if(state->forwarding_queue_tail==FORWARDING_QUEUE_DEPTH)
+                if(state->forwarding_queue_tail==forwarding_queue_depth)
                         state->forwarding_queue_tail=0;
 
                 /*
@@ -287,7 +324,7 @@ void forwarding_queue_dequeue(node_state* state){
                  * This is mandatory to implement the FIFO logic
                  */
 
-                if(state->forwarding_queue_head==FORWARDING_QUEUE_DEPTH)
+                if(state->forwarding_queue_head==forwarding_queue_depth)
                         state->forwarding_queue_head=0;
         }
 
@@ -386,7 +423,7 @@ unsigned char cache_lookup(ctp_data_packet_frame* data_frame,node_state* state){
                  * Get the index of the entry
                  */
 
-                index=(state->output_cache_first+i)%(unsigned char)CACHE_SIZE;
+                index=(state->output_cache_first+i)%(unsigned char)cache_size;
 
                 /*
                  * The data frame of the element of the cache analyzed
@@ -441,7 +478,7 @@ void cache_enqueue(ctp_data_packet_frame* data_frame,node_state* state){
          * Check whether the cache is full
          */
 
-        if(state->output_cache_count==CACHE_SIZE){
+        if(state->output_cache_count==cache_size){
 
                 /*
                  * The output cache is full => remove the least recently inserted packet from it
@@ -464,7 +501,7 @@ void cache_enqueue(ctp_data_packet_frame* data_frame,node_state* state){
          * Get the data frame of the entry where the most recently accessed element will be put
          */
 
-        new_data_frame=&state->output_cache[(state->output_cache_first+state->output_cache_count)%CACHE_SIZE].
+        new_data_frame=&state->output_cache[(state->output_cache_first+state->output_cache_count)%cache_size].
                 data_packet_frame;
 
         /*
@@ -522,7 +559,7 @@ void cache_remove(unsigned char offset,node_state* state){
 
         if(!offset) {
                 state->output_cache_first+=1;
-                state->output_cache_first = (state->output_cache_first) % (unsigned char)CACHE_SIZE;
+                state->output_cache_first = (state->output_cache_first) % (unsigned char)cache_size;
         }
         else{
 
@@ -538,7 +575,7 @@ void cache_remove(unsigned char offset,node_state* state){
                  */
 
                 for(i=offset;i<state->output_cache_count;i++){
-                        memcpy(&state->output_cache[(offset+i)%CACHE_SIZE],&state->output_cache[(offset+i+1)%CACHE_SIZE]
+                        memcpy(&state->output_cache[(offset+i)%cache_size],&state->output_cache[(offset+i+1)%cache_size]
                                 ,sizeof(ctp_data_packet));
                 }
         }
@@ -599,7 +636,7 @@ void start_forwarding_engine(node_state* state){
          * First initialize the forwarding pool
          */
 
-        state->forwarding_pool_count=FORWARDING_POOL_DEPTH;
+        state->forwarding_pool_count=forwarding_pool_depth;
         state->forwarding_pool_index=0;
 
         /*
@@ -910,7 +947,7 @@ void create_data_packet(node_state* state){
                  * case, the variable "forwarding_queue_count" is less than the depth of the queue
                  */
 
-                if (state->forwarding_queue_count < FORWARDING_QUEUE_DEPTH) {
+                if (state->forwarding_queue_count < forwarding_queue_depth) {
 
                         /*
                          * The function that is in charge of actually sending the packet, works as follows;
@@ -1286,7 +1323,7 @@ void transmitted_data_packet(node_state* state,bool result) {
                                  * ID of the latter from the last data packet sent
                                  */
 
-                                ack_received(head->link_frame.sink, true, state->link_estimator_table);
+                                ack_received(head->link_frame.sink, true, state);
 
                                 /*
                                  * If the last packet sent was a forwarded one, insert in the output cache in order to
@@ -1335,7 +1372,7 @@ void transmitted_data_packet(node_state* state,bool result) {
                          * extract the ID of the latter from the last data packet sent
                          */
 
-                        ack_received(head->link_frame.sink, false, state->link_estimator_table);
+                        ack_received(head->link_frame.sink, false, state);
 
                         /*
                          * The outgoing link quality between the current node and the recipient has possibly changed,
@@ -1427,7 +1464,7 @@ bool is_congested(node_state* state){
          * Return true if more than half is full...
          */
 
-        if(count>FORWARDING_QUEUE_DEPTH/2)
+        if(count>forwarding_queue_depth/2)
                 return true;
 
         /*
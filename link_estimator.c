@@ -18,6 +18,10 @@
  */
 
 #include <limits.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "link_estimator.h"
 #include "application.h"
 #include "link_layer.h"
@@ -27,6 +31,7 @@
  * Default values of the parameters for the link estimator (check link_estimator.h for a description)
  */
 
+unsigned int neighbor_table_size=NEIGHBOR_TABLE_SIZE;
 unsigned int evict_worst_etx_threshold=EVICT_WORST_ETX_THRESHOLD;
 unsigned int evict_best_etx_threshold=EVICT_BEST_ETX_THRESHOLD;
 unsigned int max_pkt_gap=MAX_PKT_GAP;
@@ -34,6 +39,31 @@ unsigned short alpha=ALPHA;
 unsigned int dlq_pkt_window=DLQ_PKT_WINDOW;
 unsigned int blq_pkt_window=BLQ_PKT_WINDOW;
 
+/*
+ * Number of positions of the index of the estimator table (see "neighbor index operations" below): it's the smallest
+ * power of 2 at least twice as big as the table, so the index is never more than half full
+ */
+
+unsigned int neighbor_index_size;
+
+/*
+ * Number of elements of the columns of the estimator table, i.e. the size of the table rounded up to a multiple of
+ * ESTIMATOR_COLUMN_PADDING
+ */
+
+unsigned int neighbor_columns_size;
+
+/*
+ * Position (in bytes) of the columns and of the index of the estimator table with respect to its first entry, and the
+ * total size (in bytes) of the table
+ */
+
+size_t neighbors_offset;
+size_t etxs_offset;
+size_t flags_offset;
+size_t index_offset;
+size_t estimator_table_size;
+
 /* GLOBAL VARIABLES - end */
 
 /*
@@ -42,6 +72,8 @@ unsigned int blq_pkt_window=BLQ_PKT_WINDOW;
 
 void parse_link_estimator_parameters(void* event_content){
 
+        if(IsParameterPresent(event_content, "neighbor_table_size"))
+                neighbor_table_size=(unsigned int)GetParameterInt(event_content,"neighbor_table_size");
         if(IsParameterPresent(event_content, "evict_worst_etx_threshold"))
                 evict_worst_etx_threshold=(unsigned int)GetParameterInt(event_content,"evict_worst_etx_threshold");
         if(IsParameterPresent(event_content, "evict_best_etx_threshold"))
@@ -54,8 +86,258 @@ void parse_link_estimator_parameters(void* event_content){
                 dlq_pkt_window=(unsigned short)GetParameterInt(event_content,"dlq_pkt_window");
         if(IsParameterPresent(event_content, "blq_pkt_window"))
                 blq_pkt_window=(unsigned short)GetParameterInt(event_content,"blq_pkt_window");
+
+        /*
+         * The size of the link estimator table has to fit the indexes used to scan it
+         */
+
+        if(!neighbor_table_size || neighbor_table_size>UCHAR_MAX){
+                printf("[FATAL ERROR] The size of the link estimator table has to be between 1 and %d\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Size the index of the estimator table
+         */
+
+        for(neighbor_index_size=1;neighbor_index_size<2*neighbor_table_size;neighbor_index_size<<=1);
+
+        /*
+         * Lay out the estimator table: the entries are followed by the columns of the IDs of the neighbors, of the
+         * 1-hop ETXs and of the flags, and finally by the index. All of them start at a multiple of 16 bytes
+         */
+
+        neighbor_columns_size=(neighbor_table_size+ESTIMATOR_COLUMN_PADDING-1)/ESTIMATOR_COLUMN_PADDING*
+                              ESTIMATOR_COLUMN_PADDING;
+        neighbors_offset=(sizeof(link_estimator_table_entry)*neighbor_table_size+15)/16*16;
+        etxs_offset=neighbors_offset+sizeof(unsigned int)*neighbor_columns_size;
+        flags_offset=etxs_offset+sizeof(unsigned short)*neighbor_columns_size;
+        index_offset=flags_offset+sizeof(unsigned char)*neighbor_columns_size;
+        estimator_table_size=index_offset+neighbor_index_size;
+}
+
+/*
+ * GET LINK ESTIMATOR TABLE SIZE
+ *
+ * Returns the number of bytes taken by the estimator table of a node, including its columns and its index
+ */
+
+size_t get_link_estimator_table_size(){
+        return estimator_table_size;
+}
+
+/*
+ * ESTIMATOR TABLE COLUMNS - start
+ *
+ * The IDs of the neighbors, the flags and the 1-hop ETXs of the entries are stored in separate arrays (columns), where
+ * the element at position "i" belongs to the i-th entry of the table: the columns are stored right after the entries,
+ * in the same block of memory, so they can be reached from the pointer to the table
+ */
+
+/*
+ * GET ESTIMATOR NEIGHBORS
+ *
+ * Returns the pointer to the column of the IDs of the neighbors of the given estimator table
+ *
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static unsigned int* get_estimator_neighbors(link_estimator_table_entry* link_estimator_table){
+        return (unsigned int*)((char*)link_estimator_table+neighbors_offset);
+}
+
+/*
+ * GET ESTIMATOR ETXS
+ *
+ * Returns the pointer to the column of the 1-hop ETXs of the given estimator table
+ *
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static unsigned short* get_estimator_etxs(link_estimator_table_entry* link_estimator_table){
+        return (unsigned short*)((char*)link_estimator_table+etxs_offset);
+}
+
+/*
+ * GET ESTIMATOR FLAGS
+ *
+ * Returns the pointer to the column of the flags of the given estimator table
+ *
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static unsigned char* get_estimator_flags(link_estimator_table_entry* link_estimator_table){
+        return (unsigned char*)link_estimator_table+flags_offset;
+}
+
+/*
+ * ESTIMATOR TABLE COLUMNS - end
+ */
+
+/*
+ * NEIGHBOR INDEX OPERATIONS - start
+ *
+ * The entries of the estimator table are found through an open-addressing hash table (with linear probing) from the ID
+ * of a neighbor to the position of its entry: each element of the index holds the position of an entry plus 1, or 0 if
+ * the element is empty.
+ * The index is stored right after the estimator table, in the same block of memory (see "allocate_node_tables" in
+ * "application.c"), so that it's saved and restored together with the table and it can be reached from the pointer
+ * to the table, as any other information about the neighbors
+ */
+
+/*
+ * GET NEIGHBOR INDEX
+ *
+ * Returns the pointer to the index of the given estimator table
+ *
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static unsigned char* get_neighbor_index(link_estimator_table_entry* link_estimator_table){
+        return (unsigned char*)link_estimator_table+index_offset;
+}
+
+/*
+ * HASH NEIGHBOR
+ *
+ * Returns the position of the index where the search of the entry of the given neighbor starts: the ID is scrambled by
+ * a multiplicative hash, so that neighbors with close IDs are spread over the index
+ *
+ * @neighbor: ID of the neighbor
+ */
+
+static unsigned int hash_neighbor(unsigned int neighbor){
+        return (neighbor*2654435761U)&(neighbor_index_size-1);
+}
+
+/*
+ * INDEX NEIGHBOR
+ *
+ * Add the entry of the neighbor at the given position of the estimator table to the index
+ *
+ * @index: position of the entry in the table
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static void index_neighbor(unsigned char index,link_estimator_table_entry* link_estimator_table){
+
+        /*
+         * Index of the table
+         */
+
+        unsigned char* neighbor_index=get_neighbor_index(link_estimator_table);
+
+        /*
+         * Position of the index being probed
+         */
+
+        unsigned int position=hash_neighbor(get_estimator_neighbors(link_estimator_table)[index]);
+
+        /*
+         * Look for the first empty position, starting from the one given by the hash: there's always one because the
+         * index is never more than half full
+         */
+
+        while(neighbor_index[position])
+                position=(position+1)&(neighbor_index_size-1);
+
+        /*
+         * Store the position of the entry
+         */
+
+        neighbor_index[position]=(unsigned char)(index+1);
+}
+
+/*
+ * UNINDEX NEIGHBOR
+ *
+ * Remove the entry at the given position of the estimator table from the index.
+ * The elements following the removed one are moved backwards if this brings them closer to the position given by their
+ * hash, so that no search stops before reaching the element it's looking for
+ *
+ * @index: position of the entry in the table
+ * @link_estimator_table: pointer to the link estimator table of the node
+ */
+
+static void unindex_neighbor(unsigned char index,link_estimator_table_entry* link_estimator_table){
+
+        /*
+         * Index of the table
+         */
+
+        unsigned char* neighbor_index=get_neighbor_index(link_estimator_table);
+
+        /*
+         * IDs of the neighbors of the table
+         */
+
+        unsigned int* neighbors=get_estimator_neighbors(link_estimator_table);
+
+        /*
+         * Mask used to wrap the positions of the index
+         */
+
+        unsigned int mask=neighbor_index_size-1;
+
+        /*
+         * Position of the element being removed, position of the element following it and position given by the
+         * hash of the latter
+         */
+
+        unsigned int hole;
+        unsigned int next;
+        unsigned int home;
+
+        /*
+         * Look for the element holding the position of the entry
+         */
+
+        hole=hash_neighbor(neighbors[index]);
+        while(neighbor_index[hole]!=index+1){
+
+                /*
+                 * If an empty element is found, the entry is not in the index
+                 */
+
+                if(!neighbor_index[hole])
+                        return;
+                hole=(hole+1)&mask;
+        }
+
+        /*
+         * Scan the elements following the removed one, until an empty one is found
+         */
+
+        for(next=(hole+1)&mask;neighbor_index[next];next=(next+1)&mask){
+
+                /*
+                 * Position where the search of the current element starts
+                 */
+
+                home=hash_neighbor(neighbors[neighbor_index[next]-1]);
+
+                /*
+                 * The element can fill the hole only if the hole is between its starting position and its current one
+                 * (taking into account the wrapping of the positions)
+                 */
+
+                if(((next-home)&mask)>=((next-hole)&mask)){
+                        neighbor_index[hole]=neighbor_index[next];
+                        hole=next;
+                }
+        }
+
+        /*
+         * Finally clear the element left empty
+         */
+
+        neighbor_index[hole]=0;
 }
 
+/*
+ * NEIGHBOR INDEX OPERATIONS - end
+ */
+
 /*
  * LINK ESTIMATOR TABLE OPERATIONS - start
  */
@@ -78,6 +360,13 @@ void init_estimator_entry(unsigned int neighbor, unsigned char index,link_estima
 
         link_estimator_table_entry* new_entry;
 
+        /*
+         * Columns of the table
+         */
+
+        unsigned int* neighbors=get_estimator_neighbors(link_estimator_table);
+        unsigned char* flags=get_estimator_flags(link_estimator_table);
+
         /*
          * Set pointer to the index-th element of the table
          */
@@ -85,10 +374,16 @@ void init_estimator_entry(unsigned int neighbor, unsigned char index,link_estima
         new_entry=&link_estimator_table[index];
 
         /*
-         * Set the neighbor field to the node instance of the given neighbor
+         * If the entry belongs to another neighbor (i.e. the neighbor is being evicted), remove it from the index and
+         * then add it back for the given neighbor
          */
 
-        new_entry->neighbor=neighbor;
+        if(!(flags[index] & VALID_ENTRY) || neighbors[index]!=neighbor){
+                if(flags[index] & VALID_ENTRY)
+                        unindex_neighbor(index,link_estimator_table);
+                neighbors[index]=neighbor;
+                index_neighbor(index,link_estimator_table);
+        }
 
         /*
          * Initialize fields of the entry
@@ -100,13 +395,13 @@ void init_estimator_entry(unsigned int neighbor, unsigned char index,link_estima
         new_entry->data_acknowledged=0;
         new_entry->data_sent=0;
         new_entry->ingoing_quality=0;
-        new_entry->one_hop_etx=0;
+        get_estimator_etxs(link_estimator_table)[index]=0;
 
         /*
          * Set VALID and INIT entry flags
          */
 
-        new_entry->flags=INIT_ENTRY|VALID_ENTRY;
+        flags[index]=INIT_ENTRY|VALID_ENTRY;
 }
 
 /*
@@ -123,36 +418,41 @@ void init_estimator_entry(unsigned int neighbor, unsigned char index,link_estima
 unsigned char find_estimator_entry(unsigned int neighbor,link_estimator_table_entry* link_estimator_table){
 
         /*
-         * Return value: index of the entry
+         * Index of the table
          */
 
-        unsigned char index;
+        unsigned char* neighbor_index=get_neighbor_index(link_estimator_table);
+
+        /*
+         * IDs of the neighbors of the table
+         */
+
+        unsigned int* neighbors=get_estimator_neighbors(link_estimator_table);
 
         /*
-         * Look for all the VALID entries of the neighbor table and stop when one whose ID fields corresponds to the
-         * provided ID is found
+         * Position of the index being probed
          */
 
-        for(index=0;index<NEIGHBOR_TABLE_SIZE;index++){
+        unsigned int position;
+
+        /*
+         * Probe the index starting from the position given by the hash of the ID, until an empty element is found:
+         * only VALID entries are in the index
+         */
+
+        for(position=hash_neighbor(neighbor);neighbor_index[position];position=(position+1)&(neighbor_index_size-1)){
 
                 /*
-                 * Only check entries with VALID flag set
+                 * Check if the current element refers to the entry we are looking for
                  */
 
-                if(link_estimator_table[index].flags & VALID_ENTRY){
+                if(neighbors[neighbor_index[position]-1]==neighbor) {
 
                         /*
-                         * Check if the current entry is the one we are looking for
+                         * Return the index of the entry corresponding to the neighbor
                          */
 
-                        if(link_estimator_table[index].neighbor==neighbor) {
-
-                                /*
-                                 * Return the index of the entry corresponding to the neighbor
-                                 */
-
-                                return index;
-                        }
+                        return (unsigned char)(neighbor_index[position]-1);
                 }
         }
 
@@ -164,111 +464,272 @@ unsigned char find_estimator_entry(unsigned int neighbor,link_estimator_table_en
 }
 
 /*
- * FIND WORST ENTRY
+ * MATCH FLAGS
  *
- * Returns the index of the entry in the table with the highest ETX which is greater than or equal to the given threshold
- * This routine gets called when a new entry has to be initialized in the neighbor table and there are no free entries
- * left => it helps deciding whether the new entry has to replace an existing one and, in this case, which of the existing
- * entries has to be evicted
+ * Returns a mask with the i-th bit set if the entry at position "first+i" of the table, with i lower than
+ * ESTIMATOR_COLUMN_PADDING, is VALID and its MATURE and PINNED flags are the same as in the given flags.
+ * If the processor supports the SSE2 instructions, the flags of all the entries are compared at the same time
  *
- * @etx_threshold: threshold for the value of ETX
- * @link_estimator_table: pointer to the link estimator table of the node
+ * @flags: column of the flags of the estimator table
+ * @first: position of the first entry
+ * @wanted: flags the entries must have (among VALID, MATURE and PINNED)
+ */
+
+static unsigned int match_flags(unsigned char* flags,unsigned int first,unsigned char wanted){
+
+#ifdef __SSE2__
+
+        /*
+         * Keep only the flags VALID, MATURE and PINNED of the entries and compare them with the wanted ones
+         */
+
+        __m128i entries=_mm_and_si128(_mm_loadu_si128((__m128i*)&flags[first]),
+                                      _mm_set1_epi8(VALID_ENTRY|MATURE_ENTRY|PINNED_ENTRY));
+        return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(entries,_mm_set1_epi8((char)wanted)));
+#else
+
+        /*
+         * Position of the current entry
+         */
+
+        unsigned int i;
+
+        /*
+         * Return value: the mask of the matching entries
+         */
+
+        unsigned int mask=0;
+
+        /*
+         * Compare the flags of one entry at a time
+         */
+
+        for(i=0;i<ESTIMATOR_COLUMN_PADDING;i++){
+                if((flags[first+i]&(VALID_ENTRY|MATURE_ENTRY|PINNED_ENTRY))==wanted)
+                        mask|=1U<<i;
+        }
+        return mask;
+#endif
+}
+
+/*
+ * GET HIGHEST ETX
  *
- * If no entry is found, INVALID_ENTRY is returned
+ * Returns the highest value of the lowest byte of the 1-hop ETX among the entries at positions "first" to
+ * "first+ESTIMATOR_COLUMN_PADDING" (excluded) whose bit is set in the given mask, or 0 if no bit is set
+ *
+ * @etxs: column of the 1-hop ETXs of the estimator table
+ * @first: position of the first entry
+ * @mask: mask of the entries to be taken into account, as returned by "match_flags"
  */
 
-unsigned char find_estimator_worst_entry(unsigned char etx_threshold,link_estimator_table_entry* link_estimator_table){
+static unsigned char get_highest_etx(unsigned short* etxs,unsigned int first,unsigned int mask){
+
+#ifdef __SSE2__
 
         /*
-         * Index used to scan the estimator table
+         * Lowest byte of the ETX of the entries, packed into a single vector
          */
 
-        unsigned char i;
+        __m128i low_bytes=_mm_set1_epi16(0xff);
+        __m128i etx=_mm_packus_epi16(_mm_and_si128(_mm_loadu_si128((__m128i*)&etxs[first]),low_bytes),
+                                     _mm_and_si128(_mm_loadu_si128((__m128i*)&etxs[first+8]),low_bytes));
 
         /*
-         * Return value: the index of the entry with the highest ETX beyond the given threshold
+         * Expand the mask, one byte per entry, and clear the ETX of the entries not taken into account
          */
 
-        unsigned char worst_entry_index;
+        __m128i bits=_mm_set_epi8((char)0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01,
+                                  (char)0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01);
+        __m128i selected=_mm_set_epi8((char)(mask>>8),(char)(mask>>8),(char)(mask>>8),(char)(mask>>8),
+                                      (char)(mask>>8),(char)(mask>>8),(char)(mask>>8),(char)(mask>>8),
+                                      (char)mask,(char)mask,(char)mask,(char)mask,
+                                      (char)mask,(char)mask,(char)mask,(char)mask);
+        etx=_mm_and_si128(etx,_mm_cmpeq_epi8(_mm_and_si128(selected,bits),bits));
 
         /*
-         * Highest value of ETX found while scanning the estimator table
+         * Find the highest byte by halving the vector
          */
 
-        unsigned char highest_etx;
+        etx=_mm_max_epu8(etx,_mm_srli_si128(etx,8));
+        etx=_mm_max_epu8(etx,_mm_srli_si128(etx,4));
+        etx=_mm_max_epu8(etx,_mm_srli_si128(etx,2));
+        etx=_mm_max_epu8(etx,_mm_srli_si128(etx,1));
+        return (unsigned char)_mm_cvtsi128_si32(etx);
+#else
 
         /*
-         * ETX of the current entry while scanning the estimator table
+         * Position of the current entry
          */
 
-        unsigned char current_etx;
+        unsigned int i;
 
         /*
-         * Highest value for ETX before start scanning is 0 (root node)
+         * Return value: the highest ETX
          */
 
-        highest_etx=0;
+        unsigned char highest_etx=0;
 
         /*
-         * Value returned in case no entry is found
+         * Check one entry at a time
          */
 
-        worst_entry_index=INVALID_ENTRY;
+        for(i=0;i<ESTIMATOR_COLUMN_PADDING;i++){
+                if((mask>>i&1) && (unsigned char)etxs[first+i]>highest_etx)
+                        highest_etx=(unsigned char)etxs[first+i];
+        }
+        return highest_etx;
+#endif
+}
+
+/*
+ * MATCH ETX
+ *
+ * Returns a mask with the i-th bit set if the lowest byte of the 1-hop ETX of the entry at position "first+i" of the
+ * table, with i lower than ESTIMATOR_COLUMN_PADDING, is equal to the given value
+ *
+ * @etxs: column of the 1-hop ETXs of the estimator table
+ * @first: position of the first entry
+ * @value: value of the ETX
+ */
+
+static unsigned int match_etx(unsigned short* etxs,unsigned int first,unsigned char value){
+
+#ifdef __SSE2__
 
         /*
-         * Scan the estimator table looking for the entry with the highest ETX beyond the given threshold
+         * Compare the lowest byte of the ETX of eight entries at a time
          */
 
-        for(i=0;i<NEIGHBOR_TABLE_SIZE;i++){
+        __m128i low_bytes=_mm_set1_epi16(0xff);
+        __m128i wanted=_mm_set1_epi16(value);
+        __m128i low=_mm_cmpeq_epi16(_mm_and_si128(_mm_loadu_si128((__m128i*)&etxs[first]),low_bytes),wanted);
+        __m128i high=_mm_cmpeq_epi16(_mm_and_si128(_mm_loadu_si128((__m128i*)&etxs[first+8]),low_bytes),wanted);
 
-                /*
-                 * Check whether the current entry is VALID: if not, jump to the next
-                 */
+        /*
+         * Pack the results, one byte per entry, and build the mask
+         */
 
-                if(!(link_estimator_table[i].flags & VALID_ENTRY))
-                        continue;
+        return (unsigned int)_mm_movemask_epi8(_mm_packs_epi16(low,high));
+#else
 
-                /*
-                 * Check whether the current entry is MATURE: if not, jump to the next
-                 */
+        /*
+         * Position of the current entry
+         */
 
-                if(!(link_estimator_table[i].flags & MATURE_ENTRY))
-                        continue;
+        unsigned int i;
 
-                /*
-                 * Check whether the current entry is PINNED: if so, jump to the next
-                 */
+        /*
+         * Return value: the mask of the matching entries
+         */
 
-                if(link_estimator_table[i].flags & PINNED_ENTRY)
-                        continue;
+        unsigned int mask=0;
 
-                /*
-                 * The current is VALID, MATURE and NOT PINNED => check the value of its ETX
-                 */
+        /*
+         * Compare one entry at a time
+         */
 
-                current_etx=(unsigned char)link_estimator_table[i].one_hop_etx;
+        for(i=0;i<ESTIMATOR_COLUMN_PADDING;i++){
+                if((unsigned char)etxs[first+i]==value)
+                        mask|=1U<<i;
+        }
+        return mask;
+#endif
+}
 
-                /*
-                 * If the ETX of the current entry is bigger than the ETX found so far, keep track of its index and
-                 * update the value for the highest ETX found so far
-                 */
+/*
+ * FIND WORST ENTRY
+ *
+ * Returns the index of the entry in the table with the highest ETX which is greater than or equal to the given threshold
+ * This routine gets called when a new entry has to be initialized in the neighbor table and there are no free entries
+ * left => it helps deciding whether the new entry has to replace an existing one and, in this case, which of the existing
+ * entries has to be evicted.
+ * Only the lowest byte of the ETX is compared and, if more entries have the highest ETX, the last one is chosen.
+ * The columns of the table are scanned ESTIMATOR_COLUMN_PADDING entries at a time
+ *
+ * @etx_threshold: threshold for the value of ETX
+ * @link_estimator_table: pointer to the link estimator table of the node
+ *
+ * If no entry is found, INVALID_ENTRY is returned
+ */
+
+unsigned char find_estimator_worst_entry(unsigned char etx_threshold,link_estimator_table_entry* link_estimator_table){
+
+        /*
+         * Columns of the table
+         */
+
+        unsigned char* flags=get_estimator_flags(link_estimator_table);
+        unsigned short* etxs=get_estimator_etxs(link_estimator_table);
+
+        /*
+         * Position of the first entry of the current group of entries
+         */
+
+        unsigned int first;
+
+        /*
+         * Mask of the entries of the current group that are VALID, MATURE and NOT PINNED
+         */
+
+        unsigned int mask;
 
-                if(current_etx>=highest_etx){
-                        worst_entry_index=i;
-                        highest_etx=current_etx;
+        /*
+         * Whether at least one entry is VALID, MATURE and NOT PINNED
+         */
+
+        bool found=false;
+
+        /*
+         * Highest value of ETX found while scanning the estimator table
+         */
+
+        unsigned char highest_etx=0;
+
+        /*
+         * ETX of the current group of entries
+         */
+
+        unsigned char current_etx;
+
+        /*
+         * First find the highest ETX among the entries that are VALID, MATURE and NOT PINNED
+         */
+
+        for(first=0;first<neighbor_columns_size;first+=ESTIMATOR_COLUMN_PADDING){
+                mask=match_flags(flags,first,VALID_ENTRY|MATURE_ENTRY);
+                if(mask){
+                        found=true;
+                        current_etx=get_highest_etx(etxs,first,mask);
+                        if(current_etx>highest_etx)
+                                highest_etx=current_etx;
                 }
         }
 
         /*
-         * The whole estimator table has been scanned and the highest value of ETX has been found: if this is higher
-         * than or equal to the given threshold, return the index of the corresponding entry, otherwise return
-         * INVALID_ENTRY
+         * If no entry can be evicted or the highest ETX is lower than the given threshold, return INVALID_ENTRY
          */
 
-        if(highest_etx>=etx_threshold)
-                return worst_entry_index;
-        else
+        if(!found || highest_etx<etx_threshold)
                 return INVALID_ENTRY;
+
+        /*
+         * Return the last of the entries with the highest ETX: scan the groups backwards, counting the position of the
+         * group after the current one down to 0, and stop at the first group having such an entry
+         */
+
+        for(first=neighbor_columns_size;first>0;){
+                first-=ESTIMATOR_COLUMN_PADDING;
+                mask=match_flags(flags,first,VALID_ENTRY|MATURE_ENTRY)&match_etx(etxs,first,highest_etx);
+                if(mask)
+                        return (unsigned char)(first+31-__builtin_clz(mask));
+        }
+
+        /*
+         * We never get here, because an entry with the highest ETX exists
+         */
+
+        return INVALID_ENTRY;
 }
 
 /*
@@ -277,7 +738,8 @@ unsigned char find_estimator_worst_entry(unsigned char etx_threshold,link_estima
  * Returns the index of a random entry that is VALID and NOT PINNED; if such an entry can't be found, INVALID_ENTRY is
  * returned.
  * This routine gets called when it is necessary to evict an entry of the neighbor table and known of the existing entries
- * is really worse than the other ones => choose randomly
+ * is really worse than the other ones => choose randomly.
+ * The columns of the table are scanned ESTIMATOR_COLUMN_PADDING entries at a time
  *
  * @link_estimator_table: pointer to the link estimator table of the node
  */
@@ -285,54 +747,41 @@ unsigned char find_estimator_worst_entry(unsigned char etx_threshold,link_estima
 unsigned char find_random_entry(link_estimator_table_entry* link_estimator_table){
 
         /*
-         * Index used to scan the estimator table
+         * Column of the flags of the table
          */
 
-        unsigned char i;
+        unsigned char* flags=get_estimator_flags(link_estimator_table);
 
         /*
-         * Counter used to select a random entry
+         * Position of the first entry of the current group of entries
          */
 
-        unsigned char counter;
+        unsigned int first;
 
         /*
-         * Number of entries that can be selected, i.e. VALID AND NOT PINNED NOR MATURE
+         * Mask of the entries of the current group that can be selected
          */
 
-        unsigned char candidates=0;
+        unsigned int mask;
 
         /*
-         * Scan the estimator table to count the number of candidates
+         * Counter used to select a random entry
          */
 
-        for(i=0;i<NEIGHBOR_TABLE_SIZE;i++){
-
-                /*
-                 * The entry is a candidate if it's VALID
-                 */
-
-                if(link_estimator_table[i].flags & VALID_ENTRY){
-
-                        /*
-                         * If the entry has MATURE or PINNED flags set, is not a candidate
-                         */
-
-                        if((link_estimator_table[i].flags & MATURE_ENTRY)||(link_estimator_table[i].flags & PINNED_ENTRY)){
+        unsigned char counter;
 
-                        }
-                        else{
+        /*
+         * Number of entries that can be selected, i.e. VALID AND NOT PINNED NOR MATURE
+         */
 
-                                /*
-                                 * Otherwise, it can be randomly selected
-                                 */
+        unsigned char candidates=0;
 
-                                candidates++;
+        /*
+         * Count the candidates of each group of entries
+         */
 
-                        }
-
-                }
-        }
+        for(first=0;first<neighbor_columns_size;first+=ESTIMATOR_COLUMN_PADDING)
+                candidates+=__builtin_popcount(match_flags(flags,first,VALID_ENTRY));
 
         /*
          * Check if at least one entry is eligible: if not, return INVALID_ENTRY
@@ -348,33 +797,18 @@ unsigned char find_random_entry(link_estimator_table_entry* link_estimator_table
         counter= (unsigned char)RandomRange(0,candidates);
 
         /*
-         * The entry selected is the "counter-th" entry which is VALID AND NOT PINNED NOR MATURE
+         * The entry selected is the "counter-th" entry which is VALID AND NOT PINNED NOR MATURE: skip the groups with
+         * fewer candidates than the counter, then the first "counter" candidates of the group where it's found
          */
 
-        for(i=0;i<NEIGHBOR_TABLE_SIZE;i++){
-
-                /*
-                 * Discard invalid entries
-                 */
-
-                if(!(link_estimator_table[i].flags & VALID_ENTRY))
-                        continue;
-
-                /*
-                 * Discard MATURE AND NOT PINNED entries
-                 */
-
-                if((link_estimator_table[i].flags & MATURE_ENTRY)||(link_estimator_table[i].flags & PINNED_ENTRY)){
-                        continue;
+        for(first=0;first<neighbor_columns_size;first+=ESTIMATOR_COLUMN_PADDING){
+                mask=match_flags(flags,first,VALID_ENTRY);
+                if(counter<__builtin_popcount(mask)){
+                        while(counter--)
+                                mask&=mask-1;
+                        return (unsigned char)(first+__builtin_ctz(mask));
                 }
-
-                /*
-                 * The current entry is VALID AND NOT PINNED NOR MATURE => if it's the "counter-th" entry of the table
-                 * with such characteristics, return its index, otherwise iterate
-                 */
-
-                if(counter--==0)
-                        return i;
+                counter-=__builtin_popcount(mask);
         }
 
         /*
@@ -404,13 +838,13 @@ unsigned char find_estimator_free_entry(link_estimator_table_entry* link_estimat
          * Look for all the entries of the neighbor table and stop when one is not valid
          */
 
-        for(index=0;index<NEIGHBOR_TABLE_SIZE;index++){
+        for(index=0;index<neighbor_table_size;index++){
 
                 /*
                  * Skip valid entries
                  */
 
-                if(link_estimator_table[index].flags & VALID_ENTRY){
+                if(get_estimator_flags(link_estimator_table)[index] & VALID_ENTRY){
 
                 }
 
@@ -455,16 +889,23 @@ void init_link_estimator_table(link_estimator_table_entry* link_estimator_table)
          * Index variable used to iterate through entries in the table
          */
 
-        int i=0;
+        unsigned int i=0;
 
         /*
-         * Set all the entries
+         * Set all the entries, including the ones padding the columns
          */
 
-        for(i=0;i<NEIGHBOR_TABLE_SIZE;i++){
-                link_estimator_table[i].flags=0;
-                link_estimator_table[i].neighbor=UINT_MAX-1;
+        for(i=0;i<neighbor_columns_size;i++){
+                get_estimator_flags(link_estimator_table)[i]=0;
+                get_estimator_neighbors(link_estimator_table)[i]=UINT_MAX-1;
+                get_estimator_etxs(link_estimator_table)[i]=0;
         }
+
+        /*
+         * Clear the index
+         */
+
+        memset(get_neighbor_index(link_estimator_table),0,neighbor_index_size);
 }
 
 /*
@@ -477,12 +918,18 @@ void init_link_estimator_table(link_estimator_table_entry* link_estimator_table)
  * The function checks whether the entry exists and, if not, tries to create one
  *
  * @neighbor: ID of the neighbor the entry has to be created for
- * @link_estimator_table: pointer to the link estimator table of the node
+ * @state: pointer to the object representing the current state of the node
  *
  * Returns the ID of the node corresponding to an entry removed (if any), -1 otherwise
  */
 
-int insert_neighbor(unsigned int neighbor,link_estimator_table_entry* link_estimator_table){
+int insert_neighbor(unsigned int neighbor,node_state* state){
+
+        /*
+         * Pointer to the link estimator table of the node
+         */
+
+        link_estimator_table_entry* link_estimator_table=state->link_estimator_table;
 
         /*
          * Index of the entry in the estimator table that matches the addres (if any)
@@ -490,6 +937,12 @@ int insert_neighbor(unsigned int neighbor,link_estimator_table_entry* link_estim
 
         unsigned char index;
 
+        /*
+         * ID of the neighbor whose entry is replaced
+         */
+
+        unsigned int victim;
+
         /*
          * Search the estimator table for an entry with the given address
          */
@@ -543,14 +996,15 @@ int insert_neighbor(unsigned int neighbor,link_estimator_table_entry* link_estim
                                  * A victim node has been found => replace it
                                  */
 
+                                victim=get_estimator_neighbors(link_estimator_table)[index];
                                 init_estimator_entry(neighbor,index,link_estimator_table);
 
                                 /*
                                  * An entry has been removed from the neighbor table => return the ID of the
-                                 * corresponding node
+                                 * corresponding node, so that the ROUTING ENGINE removes it from the routing table
                                  */
 
-                                return link_estimator_table[index].neighbor;
+                                return (int)victim;
                         }
                 }
         }
@@ -607,13 +1061,13 @@ unsigned short get_one_hop_etx(unsigned int address,link_estimator_table_entry*
          * Check if the corresponding entry is MATURE
          */
 
-        if(link_estimator_table[index].flags & MATURE_ENTRY){
+        if(get_estimator_flags(link_estimator_table)[index] & MATURE_ENTRY){
 
                 /*
                  * The entry is not being initialized => return its 1-hop TX
                  */
 
-                return link_estimator_table[index].one_hop_etx;
+                return get_estimator_etxs(link_estimator_table)[index];
         }
 
         /*
@@ -666,7 +1120,7 @@ bool unpin_neighbor(unsigned int address,link_estimator_table_entry* link_estima
          * The entry has been found => unpin it
          */
 
-        link_estimator_table[index].flags&=~PINNED_ENTRY;
+        get_estimator_flags(link_estimator_table)[index]&=~PINNED_ENTRY;
 
         /*
          * Unpinning was successful
@@ -719,7 +1173,7 @@ bool pin_neighbor(unsigned int address,link_estimator_table_entry* link_estimato
          * The entry has been found => pin it
          */
 
-        link_estimator_table[index].flags|=PINNED_ENTRY;
+        get_estimator_flags(link_estimator_table)[index]|=PINNED_ENTRY;
 
         /*
          * Pinning was successful
@@ -912,12 +1366,12 @@ unsigned short compute_ETX(unsigned char new_quality){
  * IMPORTANT NOTE: both the ingoing and outgoing quality parameters are scaled by 10 in order not too lose too much
  * precision due to integer divisions, so the final value computed for 1-hop ETX has to be "rescaled" dividing by 10
  *
- * @table_entry: pointer to the entry in the table corresponding to the 1-hop ETX to be updated
+ * @one_hop_etx: pointer to the element of the column of the 1-hop ETXs to be updated
  * @new_quality: new estimation of the link quality
  */
 
-void update_ETX(link_estimator_table_entry* entry,unsigned short new_quality){
-        entry->one_hop_etx=(alpha * entry->one_hop_etx + (10 - alpha) * new_quality)/10;
+void update_ETX(unsigned short* one_hop_etx,unsigned short new_quality){
+        *one_hop_etx=(alpha * *one_hop_etx + (10 - alpha) * new_quality)/10;
 }
 
 /*
@@ -930,9 +1384,10 @@ void update_ETX(link_estimator_table_entry* entry,unsigned short new_quality){
  * been sent, the value for outgoing link quality in case no ack is received can be at most DLQ_PKT_WINDOW
  *
  * @table_entry: pointer to the entry in the table corresponding to the 1-hop ETX to be updated
+ * @one_hop_etx: pointer to the element of the column of the 1-hop ETXs corresponding to the entry
  */
 
-void update_outgoing_quality(link_estimator_table_entry* entry){
+void update_outgoing_quality(link_estimator_table_entry* entry,unsigned short* one_hop_etx){
 
         /*
          * Updated value of the outgoing quality of the link to the neighbor
@@ -971,7 +1426,7 @@ void update_outgoing_quality(link_estimator_table_entry* entry){
          * Recompute the 1-hop ETX of the link to the neighbor
          */
 
-        update_ETX(entry,new_outgoing_quality);
+        update_ETX(one_hop_etx,new_outgoing_quality);
 }
 
 /*
@@ -991,7 +1446,7 @@ void update_outgoing_quality(link_estimator_table_entry* entry){
 void update_ingoing_quality(unsigned int neighbor,link_estimator_table_entry* link_estimator_table){
 
         /*
-         * Index to iterate through the entries of the table
+         * Index of the entry of the neighbor in the table
          */
 
         unsigned char i;
@@ -1015,105 +1470,89 @@ void update_ingoing_quality(unsigned int neighbor,link_estimator_table_entry* li
         unsigned char new_ingoing_quality;
 
         /*
-         * Scan the estimator table looking for the entry corresponding to the ID of the neighbor
+         * Look for the entry corresponding to the ID of the neighbor: if there's none, there's nothing to update
          */
 
-        for(i=0;i<NEIGHBOR_TABLE_SIZE;i++){
-
-                /*
-                 * Get the current entry
-                 */
-
-                entry=&link_estimator_table[i];
+        i=find_estimator_entry(neighbor,link_estimator_table);
+        if(i==INVALID_ENTRY)
+                return;
 
-                /*
-                 * Check if the current entry corresponds to the neighbor
-                 */
-
-                if(entry->neighbor==neighbor){
-
-                        /*
-                         * Entry corresponding to the neighbor found
-                         * Check if the entry is VALID
-                         */
+        /*
+         * Get the entry
+         */
 
-                        if(entry->flags & VALID_ENTRY){
+        entry=&link_estimator_table[i];
 
-                                /*
-                                 * The entry is valid
-                                 * Get the total number of beacons sent by the neighbor so far
-                                 */
+        /*
+         * Get the total number of beacons sent by the neighbor so far
+         */
 
-                                total_beacons=entry->beacons_missed+entry->beacons_received;
+        total_beacons=entry->beacons_missed+entry->beacons_received;
 
-                                /*
-                                 * Check if the flag MATURE is set (i.e. if the total number of beacons received by the
-                                 * neighbor was bigger than BLQ_PKT_WINDOW before this function was invoked): if not,
-                                 * this means the ingoing quality has not been evaluated yet, then do this now; also
-                                 * compute the first value for 1-hop ETX
-                                 */
+        /*
+         * Check if the flag MATURE is set (i.e. if the total number of beacons received by the
+         * neighbor was bigger than BLQ_PKT_WINDOW before this function was invoked): if not,
+         * this means the ingoing quality has not been evaluated yet, then do this now; also
+         * compute the first value for 1-hop ETX
+         */
 
-                                if(!(entry->flags & MATURE_ENTRY)){
+        if(!(get_estimator_flags(link_estimator_table)[i] & MATURE_ENTRY)){
 
-                                        /*
-                                         * The entry is NOT MATURE => update the value for ingoing link quality.
-                                         * This values is equal to the number of beacons received over the number of
-                                         * beacons sent by the neighbor; also the value is scaled by 250 in order not
-                                         * to lose too much precision because of truncation of integer division
-                                         */
+                /*
+                 * The entry is NOT MATURE => update the value for ingoing link quality.
+                 * This values is equal to the number of beacons received over the number of
+                 * beacons sent by the neighbor; also the value is scaled by 250 in order not
+                 * to lose too much precision because of truncation of integer division
+                 */
 
-                                        new_ingoing_quality=(250UL * entry->beacons_received) / total_beacons;
+                new_ingoing_quality=(250UL * entry->beacons_received) / total_beacons;
 
-                                        /*
-                                         * Update the corresponding field in the entry
-                                         */
+                /*
+                 * Update the corresponding field in the entry
+                 */
 
-                                        entry->ingoing_quality=new_ingoing_quality;
+                entry->ingoing_quality=new_ingoing_quality;
 
-                                        /*
-                                         * Compute the first value for 1-hop ETX of the neighbor
-                                         */
+                /*
+                 * Compute the first value for 1-hop ETX of the neighbor
+                 */
 
-                                        entry->one_hop_etx=compute_ETX(new_ingoing_quality);
-                                }
+                get_estimator_etxs(link_estimator_table)[i]=compute_ETX(new_ingoing_quality);
+        }
 
-                                /*
-                                 * Set the flag MATURE in the entry (even if already set)
-                                 */
+        /*
+         * Set the flag MATURE in the entry (even if already set)
+         */
 
-                                entry->flags |=MATURE_ENTRY;
+        get_estimator_flags(link_estimator_table)[i] |=MATURE_ENTRY;
 
-                                /*
-                                 * When we get here, we can be sure that the entry of the neighbor has some values
-                                 * for ingoing quality and 1-hop ETX.
-                                 * First compute the new value for ingoing quality
-                                 */
+        /*
+         * When we get here, we can be sure that the entry of the neighbor has some values
+         * for ingoing quality and 1-hop ETX.
+         * First compute the new value for ingoing quality
+         */
 
-                                new_ingoing_quality=(250UL * entry->beacons_received) / total_beacons;
+        new_ingoing_quality=(250UL * entry->beacons_received) / total_beacons;
 
-                                /*
-                                 * Filter the new value of ingoing quality and store the result in the corresponding
-                                 * field of the entry
-                                 */
+        /*
+         * Filter the new value of ingoing quality and store the result in the corresponding
+         * field of the entry
+         */
 
-                                entry->ingoing_quality=(alpha*entry->ingoing_quality+(10-alpha)*new_ingoing_quality)/10;
+        entry->ingoing_quality=(alpha*entry->ingoing_quality+(10-alpha)*new_ingoing_quality)/10;
 
-                                /*
-                                 * Reset counters for received and missed beacons
-                                 */
+        /*
+         * Reset counters for received and missed beacons
+         */
 
-                                entry->beacons_received=0;
-                                entry->beacons_missed=0;
+        entry->beacons_received=0;
+        entry->beacons_missed=0;
 
-                                /*
-                                 * Update the value of 1-hop ETX for this entry with the new value for ingoing quality
-                                 */
+        /*
+         * Update the value of 1-hop ETX for this entry with the new value for ingoing quality
+         */
 
-                                update_ETX(entry,compute_ETX(entry->ingoing_quality));
-                        }
-                        break;
-                }
-        }
+        update_ETX(&get_estimator_etxs(link_estimator_table)[i],compute_ETX(entry->ingoing_quality));
 }
 
 /*
@@ -1141,13 +1580,13 @@ void update_neighbor_entry(unsigned char index, unsigned char seq,link_estimator
          * first message from the neighbor; in fact, there's an entry dedicated to him in the estimator table
          */
 
-        if(link_estimator_table[index].flags & INIT_ENTRY){
+        if(get_estimator_flags(link_estimator_table)[index] & INIT_ENTRY){
 
                 /*
                  * Clear the flag
                  */
 
-                link_estimator_table[index].flags&=~INIT_ENTRY;
+                get_estimator_flags(link_estimator_table)[index]&=~INIT_ENTRY;
         }
 
         /*
@@ -1185,7 +1624,7 @@ void update_neighbor_entry(unsigned char index, unsigned char seq,link_estimator
                  * Reinitialize entry
                  */
 
-                init_estimator_entry(link_estimator_table[index].neighbor,index,link_estimator_table);
+                init_estimator_entry(get_estimator_neighbors(link_estimator_table)[index],index,link_estimator_table);
 
                 /*
                  * Update the sequence number and counter of beacons received of re-created entry
@@ -1204,7 +1643,7 @@ void update_neighbor_entry(unsigned char index, unsigned char seq,link_estimator
 
                 if((link_estimator_table[index].beacons_missed+link_estimator_table[index].beacons_received>=blq_pkt_window)
                    || (lost_beacons>=blq_pkt_window)) {
-                        update_ingoing_quality(link_estimator_table[index].neighbor, link_estimator_table);
+                        update_ingoing_quality(get_estimator_neighbors(link_estimator_table)[index], link_estimator_table);
                 }
         }
 }
@@ -1236,6 +1675,12 @@ void process_received_beacon(link_layer_frame* link_frame,ctp_link_estimator_fra
 
         unsigned int sender;
 
+        /*
+         * ID of the neighbor whose entry is randomly replaced by the one of the sender, if any
+         */
+
+        unsigned int victim;
+
         /*
          * Get a pointer to the link estimator table of the current node
          */
@@ -1334,7 +1779,7 @@ void process_received_beacon(link_layer_frame* link_frame,ctp_link_estimator_fra
                                          * entry in the estimator table with the ID of the node to be added
                                          */
 
-                                        neighbor_evicted(link_estimator_table[index].neighbor,state);
+                                        neighbor_evicted(get_estimator_neighbors(link_estimator_table)[index],state);
                                         init_estimator_entry(sender,index,link_estimator_table);
                                 }
                                 else
@@ -1380,7 +1825,8 @@ void process_received_beacon(link_layer_frame* link_frame,ctp_link_estimator_fra
                                                          * IT HAS TO BE REMOVED FROM THE ROUTING TABLE
                                                          */
 
-                                                        neighbor_evicted(sender, state);
+                                                        victim=get_estimator_neighbors(link_estimator_table)[index];
+                                                        neighbor_evicted(victim, state);
 
                                                         /*
                                                          * Replace the victim entry with the one of the new neighbor
@@ -1395,6 +1841,13 @@ void process_received_beacon(link_layer_frame* link_frame,ctp_link_estimator_fra
                         }
 
                 }
+
+                /*
+                 * The entry of the sender has been updated, created or reinitialized => let the ROUTING ENGINE know
+                 * about its 1-hop ETX
+                 */
+
+                neighbor_etx_changed(sender,state);
         }
 }
 
@@ -1437,14 +1890,20 @@ void receive_routing_packet(void* message,node_state* state){
  *
  * Function called by the FORWARDING ENGINE to signal that the intended recipient of a data packet sent or did not send
  * the corresponding acknowledgment => as a consequence, the outgoing link quality between the current node and the
- * recipient has to be re-computed.
+ * recipient has to be re-computed; if the 1-hop ETX changes, the ROUTING ENGINE is notified.
  *
  * @recipient: ID of the intended recipient
  * @ack_received: boolean variable indicating whether the ack has been received or not
- * @link_estimator_table: pointer to the link estimator table of the node
+ * @state: pointer to the object representing the current state of the node
  */
 
-void ack_received(unsigned int recipient,bool ack_received,link_estimator_table_entry* link_estimator_table){
+void ack_received(unsigned int recipient,bool ack_received,node_state* state){
+
+        /*
+         * Pointer to the link estimator table of the node
+         */
+
+        link_estimator_table_entry* link_estimator_table=state->link_estimator_table;
 
         /*
          * Pointer to the entry of the table corresponding to the given recipient
@@ -1494,14 +1953,21 @@ void ack_received(unsigned int recipient,bool ack_received,link_estimator_table_
                  * update of the outgoing link quality
                  */
 
-                if(entry->data_sent>=dlq_pkt_window)
+                if(entry->data_sent>=dlq_pkt_window){
 
                         /*
                          * The time has come to update the outgoing link quality of the link between the current node
                          * and the one corresponding to the given ID
                          */
 
-                        update_outgoing_quality(entry);
+                        update_outgoing_quality(entry,&get_estimator_etxs(link_estimator_table)[index]);
+
+                        /*
+                         * Let the ROUTING ENGINE know about the new 1-hop ETX
+                         */
+
+                        neighbor_etx_changed(recipient,state);
+                }
         }
 }
 
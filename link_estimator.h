@@ -2,6 +2,7 @@
 #define SENSORSNETWORKMODELPROJECT_LINK_ESTIMATOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct _ctp_routing_packet ctp_routing_packet;
 typedef struct _ctp_link_estimator_frame ctp_link_estimator_frame;
@@ -13,7 +14,7 @@ typedef double simtime_t;
  */
 
 #ifndef NEIGHBOR_TABLE_SIZE
-#define NEIGHBOR_TABLE_SIZE 10 // Number of entries in the link estimator table (aka neighbor table)
+#define NEIGHBOR_TABLE_SIZE 10 // Default number of entries in the link estimator table (aka neighbor table)
 #endif
 
 /*
@@ -71,14 +72,23 @@ typedef double simtime_t;
 #define INVALID_ENTRY 0xff // Value returned when the entry corresponding to a neighbor is not found
 #endif
 
+/*
+ * The columns of the estimator table (see below) are padded to a multiple of this number of entries, which is the
+ * number of flags compared by a single SSE2 instruction: the padding entries are never valid
+ */
+
+#define ESTIMATOR_COLUMN_PADDING 16
+
 
 /*
  * Structure that describes an entry in the link estimator table (or neighbor table): it reports the features of a link
- * to a neighbor node
+ * to a neighbor node.
+ * The fields scanned when looking for an entry to evict, i.e. the ID of the neighbor, the flags and the 1-hop ETX, are
+ * not part of the structure: they are stored in separate arrays (columns) following the entries, one element per entry,
+ * so that they can be scanned many entries at a time (see "link_estimator.c")
  */
 
 typedef struct _link_estimator_table_entry{
-        unsigned int neighbor; // ID of the neighbor
         unsigned char lastseq; // Last beacon sequence number received from the neighbor
 
         /*
@@ -94,9 +104,7 @@ typedef struct _link_estimator_table_entry{
          */
 
         unsigned char beacons_missed;
-        unsigned char flags; // Flags describing the state of the entry (see above)
         unsigned char ingoing_quality; // Ingoing quality of the link ranges from 1 (bad) to 255 (good)
-        unsigned short one_hop_etx; // 1-hop etx of the neighbor
 
         /*
          * Number of data packets acknowleged after the last update of the outgoing link quality: such an update takes
@@ -155,10 +163,11 @@ bool clear_data_link_quality(unsigned int address,link_estimator_table_entry* li
 bool send_routing_packet(node_state* state);
 void receive_routing_packet(void* message,node_state* state);
 bool pin_neighbor(unsigned int address,link_estimator_table_entry* link_estimator_table);
-int insert_neighbor(unsigned int neighbor,link_estimator_table_entry* link_estimator_table);
-void ack_received(unsigned int recipient,bool ack_received,link_estimator_table_entry* link_estimator_table);
+int insert_neighbor(unsigned int neighbor,node_state* state);
+void ack_received(unsigned int recipient,bool ack_received,node_state* state);
 void init_link_estimator_table(link_estimator_table_entry* link_estimator_table);
 void parse_link_estimator_parameters(void* event_content);
+size_t get_link_estimator_table_size();
 bool compare_link_estimator_frames(ctp_link_estimator_frame* a,ctp_link_estimator_frame* b);
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <math.h>
+#include <limits.h>
 #include "link_layer.h"
 #include "physical_layer.h"
 
@@ -31,6 +32,20 @@
  * equal to CSMA_MIN_FREE_SAMPLES before starting to send a frame; also there's an upper bound for the number of times
  * the node checks if the channel is free (CSMA_MAX_FREE_SAMPLES).
  * The initial value for the backoff time is selected in the range [CSMA_INIT_LOW,CSMA_INIT_HIGH]
+ *
+ * Optionally, the radio of the nodes is duty-cycled (Low Power Listening): it wakes up every LPL_WAKE_INTERVAL seconds
+ * and stays on for LPL_CHECK_DURATION seconds, so it can only sense the frames sent to it while it's on. The wake-up
+ * times of each node only depend on its ID, so every node knows when the others are listening:
+ *
+ * 1 - a beacon is sent over and over for a whole wake interval, so each neighbour receives the first copy that starts
+ *     after it wakes up and doesn't sense the others
+ * 2 - a data packet is sent when its recipient wakes up, i.e. the samples of the channel are delayed until the radio of
+ *     the recipient is on, so the nodes that are sleeping in the meanwhile don't even sense it
+ *
+ * As an alternative to CSMA, the nodes can use TDMA: time is divided in periodic frames of slots and each node only
+ * transmits at the beginning of its own slot, without sensing the channel. The slots are assigned once, before the
+ * simulation starts, by a greedy coloring of the nodes such that two nodes have different slots if one can hear the
+ * other or if a third node can hear both of them: this way no frame is ever lost because of a collision
  */
 
 /* GLOBAL VARIABLES - start
@@ -51,6 +66,21 @@ unsigned int csma_exponent_base=CSMA_EXPONENT_BASE;
 unsigned int csma_preamble_length=CSMA_PREAMBLE_LENGTH;
 unsigned int csma_ack_time=CSMA_ACK_TIME;
 double csma_sensitivity=CSMA_SENSITIVITY;
+bool csma_skip_busy_samples=CSMA_SKIP_BUSY_SAMPLES;
+double lpl_wake_interval=LPL_WAKE_INTERVAL;
+double lpl_check_duration=LPL_CHECK_DURATION;
+bool tdma=TDMA;
+double tdma_slot_duration=TDMA_SLOT_DURATION;
+
+/*
+ * TDMA SLOTS
+ *
+ * Dynamically allocated array containing the slot owned by each node, indexed by the ID of the node, and the number of
+ * slots in a TDMA frame: they are set once, before the simulation starts (see "build_tdma_schedule")
+ */
+
+unsigned int* tdma_slots=NULL;
+unsigned int tdma_frame_length;
 
 /* GLOBAL VARIABLES - end */
 
@@ -88,6 +118,169 @@ void parse_link_layer_parameters(void* event_content){
                 csma_ack_time=(unsigned int)GetParameterInt(event_content,"csma_ack_time");
         if(IsParameterPresent(event_content, "csma_sensitivity"))
                 csma_sensitivity = GetParameterDouble(event_content, "csma_sensitivity");
+        if(IsParameterPresent(event_content, "csma_skip_busy_samples"))
+                csma_skip_busy_samples=(bool)GetParameterInt(event_content,"csma_skip_busy_samples");
+        if(IsParameterPresent(event_content, "lpl_wake_interval"))
+                lpl_wake_interval=GetParameterDouble(event_content,"lpl_wake_interval");
+        if(IsParameterPresent(event_content, "lpl_check_duration"))
+                lpl_check_duration=GetParameterDouble(event_content,"lpl_check_duration");
+        if(IsParameterPresent(event_content, "tdma"))
+                tdma=(bool)GetParameterInt(event_content,"tdma");
+        if(IsParameterPresent(event_content, "tdma_slot_duration"))
+                tdma_slot_duration=GetParameterDouble(event_content,"tdma_slot_duration");
+
+        /*
+         * The radio has to be on for a part of the wake interval
+         */
+
+        if(lpl_wake_interval<0 || (lpl_wake_interval>0 && (lpl_check_duration<=0 ||
+                                                           lpl_check_duration>lpl_wake_interval))){
+                printf("[FATAL ERROR] The check duration of the LPL has to be positive and not longer than the wake "
+                               "interval\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * GET WAKE-UP OFFSET
+ *
+ * Return the time elapsed since the last wake-up of the radio of the given node, at the given time: the radio of each
+ * node wakes up at the multiples of the wake interval, shifted by an offset that only depends on the ID of the node, so
+ * that the nodes don't wake up all together
+ *
+ * @node: ID of the node
+ * @time: the time
+ */
+
+static simtime_t get_wake_up_offset(unsigned int node,simtime_t time){
+
+        /*
+         * Shift of the wake-ups of the node, as a fraction of the wake interval: it's drawn from the ID of the node by
+         * a multiplicative hash
+         */
+
+        double phase=(double)(((uint64_t)node+1)*0x9E3779B97F4A7C15ULL>>11)/9007199254740992.0;
+
+        /*
+         * Time elapsed since the last wake-up
+         */
+
+        simtime_t offset=fmod(time-phase*lpl_wake_interval,lpl_wake_interval);
+        return offset<0?offset+lpl_wake_interval:offset;
+}
+
+/*
+ * IS RADIO AWAKE
+ *
+ * Return true if the radio of the given node is on at the given time, i.e. if LPL is not used or the node is checking
+ * whether a frame is coming
+ *
+ * @node: ID of the node
+ * @time: the time
+ */
+
+bool is_radio_awake(unsigned int node,simtime_t time){
+        if(!lpl_wake_interval)
+                return true;
+        return get_wake_up_offset(node,time)<lpl_check_duration;
+}
+
+/*
+ * GET NEXT WAKE-UP
+ *
+ * Return the first time, not before the given one, when the radio of the given node is on
+ *
+ * @node: ID of the node
+ * @time: the time
+ */
+
+simtime_t get_next_wake_up(unsigned int node,simtime_t time){
+
+        /*
+         * Time elapsed since the last wake-up of the node
+         */
+
+        simtime_t offset;
+
+        if(!lpl_wake_interval)
+                return time;
+        offset=get_wake_up_offset(node,time);
+        if(offset<lpl_check_duration)
+                return time;
+        return time+lpl_wake_interval-offset;
+}
+
+/*
+ * GET RECEPTION START
+ *
+ * Compute the time when the given node starts sensing a frame whose transmission starts at the given time: without
+ * LPL, it's the time when the transmission starts.
+ * With LPL, a beacon is sent over and over, so the node senses the first copy starting after it wakes up, while a data
+ * packet is only sensed if the radio of the node is on when its transmission starts
+ *
+ * @sink: ID of the node
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ * @start: time when the transmission of the frame starts
+ * @duration: time it takes to transmit a copy of the frame
+ * @reception: pointer to the variable where the time is stored
+ *
+ * Returns false if the node doesn't sense the frame at all
+ */
+
+bool get_reception_start(unsigned int sink,unsigned char type,simtime_t start,simtime_t duration,
+                         simtime_t* reception){
+
+        /*
+         * Time when the radio of the node is on for the first time after the transmission starts
+         */
+
+        simtime_t wake_up;
+
+        if(!lpl_wake_interval){
+                *reception=start;
+                return true;
+        }
+        if(type==CTP_DATA_PACKET){
+                *reception=start;
+                return is_radio_awake(sink,start);
+        }
+
+        /*
+         * The node senses the first copy of the beacon starting after it's on
+         */
+
+        wake_up=get_next_wake_up(sink,start);
+        *reception=start+ceil((wake_up-start)/duration)*duration;
+        return true;
+}
+
+/*
+ * GET SAMPLE TIME
+ *
+ * Return the time when the node has to sample the channel after the given backoff: with LPL, a data packet can only be
+ * sent when its recipient is listening, so if the recipient is sleeping at the end of the backoff, the node waits for
+ * it to wake up and then backs off again, so that the nodes sending to the same recipient don't all sample the channel
+ * as soon as it wakes up
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @time: time when the backoff starts
+ * @backoff: the backoff time
+ */
+
+static simtime_t get_sample_time(node_state* state,simtime_t time,simtime_t backoff){
+
+        /*
+         * ID of the recipient of the data packet
+         */
+
+        unsigned int recipient;
+
+        if(!lpl_wake_interval || state->link_layer_outgoing_type!=CTP_DATA_PACKET)
+                return time+backoff;
+        recipient=state->forwarding_queue[state->forwarding_queue_head]->packet.link_frame.sink;
+        if(is_radio_awake(recipient,time+backoff))
+                return time+backoff;
+        return get_next_wake_up(recipient,time+backoff)+backoff;
 }
 
 /*
@@ -121,6 +314,242 @@ void init_link_layer(node_state* state){
         state->routing_packet.link_frame.src=state->me;
 }
 
+/*
+ * BUILD TDMA SCHEDULE
+ *
+ * Assign a TDMA slot to each node, so that two nodes have different slots if one of them can hear the other (a node
+ * can't receive while it's transmitting) or if a third node can hear both of them (the third node would sense their
+ * frames at the same time): this is a coloring of the graph of the conflicts, where the slots are the colors.
+ * The nodes are colored one at a time, in order of ID, with the lowest slot not owned by any node they conflict with.
+ * The nodes that can hear each node are taken from the physical layer (see "get_audible_nodes"); they are stored
+ * contiguously for all the nodes, as the links in the gain table, together with the nodes that each node can hear.
+ * It's invoked once, while the topology is loaded; the default length of the slots is also set here
+ */
+
+void build_tdma_schedule(){
+
+        /*
+         * Nodes that can hear each node (those that can hear node "i" are in the range
+         * [hearing_offsets[i],hearing_offsets[i+1]) of "hearing_nodes") and nodes that each node can hear, stored in the
+         * same way
+         */
+
+        unsigned int* hearing_offsets;
+        unsigned int* hearing_nodes;
+        unsigned int* heard_offsets;
+        unsigned int* heard_nodes;
+
+        /*
+         * Buffer where the nodes that can hear a node are stored by the physical layer, their number and the total
+         * number of pairs of nodes where one can hear the other
+         */
+
+        unsigned int* audible;
+        unsigned int audible_count;
+        unsigned long pairs=0;
+
+        /*
+         * Number of elements allocated for the nodes that can hear each node: the array grows as the nodes are added
+         */
+
+        unsigned long hearing_capacity=n_prc_tot;
+
+        /*
+         * For each slot, the last node that found it owned by a node it conflicts with
+         */
+
+        unsigned int* marks;
+
+        /*
+         * IDs of the nodes, indexes of the pairs and slot
+         */
+
+        unsigned int node;
+        unsigned int other;
+        unsigned int third;
+        unsigned long pair;
+        unsigned long second_pair;
+        unsigned int slot;
+
+        /*
+         * With LPL, frames last longer than a slot: the two can't be used together
+         */
+
+        if(lpl_wake_interval){
+                printf("[FATAL ERROR] TDMA can't be used together with LPL\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * If the length of the slots is not given, set it to the time it takes to transmit the longest frame, plus the
+         * time to receive the acknowledgment and to switch the radio back to reception (see "start_frame_transmission")
+         */
+
+        if(!tdma_slot_duration){
+                tdma_slot_duration=(CTP_BEACON_LENGTH>CTP_DATA_PACKET_LENGTH?CTP_BEACON_LENGTH:CTP_DATA_PACKET_LENGTH)*8/
+                                   (double)csma_bits_per_symbol;
+                tdma_slot_duration+=csma_preamble_length+csma_ack_time+csma_rxtx_delay;
+                tdma_slot_duration/=(double)csma_symbols_per_sec;
+        }
+
+        /*
+         * Allocate the buffer for the nodes that can hear a node and the offsets of the nodes that can hear each node
+         */
+
+        audible=malloc(sizeof(unsigned int)*n_prc_tot);
+        hearing_offsets=malloc(sizeof(unsigned int)*(n_prc_tot+1));
+        heard_offsets=calloc(n_prc_tot+1,sizeof(unsigned int));
+        hearing_nodes=malloc(sizeof(unsigned int)*hearing_capacity);
+        tdma_slots=malloc(sizeof(unsigned int)*n_prc_tot);
+        marks=malloc(sizeof(unsigned int)*n_prc_tot);
+        if(!audible || !hearing_offsets || !heard_offsets || !hearing_nodes || !tdma_slots || !marks){
+                printf("[FATAL ERROR] Not enough memory to build the TDMA schedule\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Get the nodes that can hear each node and append them to the ones of the previous nodes, counting how many
+         * nodes each node can hear
+         */
+
+        for(node=0;node<n_prc_tot;node++){
+                hearing_offsets[node]=(unsigned int)pairs;
+                audible_count=get_audible_nodes(node,audible);
+
+                /*
+                 * Check if the array is full: if so, double its size until the new nodes fit
+                 */
+
+                if(pairs+audible_count>hearing_capacity){
+                        while(pairs+audible_count>hearing_capacity)
+                                hearing_capacity*=2;
+                        hearing_nodes=realloc(hearing_nodes,sizeof(unsigned int)*hearing_capacity);
+                        if(!hearing_nodes){
+                                printf("[FATAL ERROR] Not enough memory to build the TDMA schedule\n");
+                                exit(EXIT_FAILURE);
+                        }
+                }
+                for(other=0;other<audible_count;other++){
+                        hearing_nodes[pairs++]=audible[other];
+                        heard_offsets[audible[other]+1]++;
+                }
+        }
+        hearing_offsets[n_prc_tot]=(unsigned int)pairs;
+
+        /*
+         * Turn the number of nodes heard by each node into the position of the first of them, then store the pairs the
+         * other way round: "heard_offsets[i]" is used as the position of the next node heard by "i" and then moved back
+         */
+
+        for(node=0;node<n_prc_tot;node++)
+                heard_offsets[node+1]+=heard_offsets[node];
+        heard_nodes=malloc(sizeof(unsigned int)*(pairs+1));
+        if(!heard_nodes){
+                printf("[FATAL ERROR] Not enough memory to build the TDMA schedule\n");
+                exit(EXIT_FAILURE);
+        }
+        for(node=0;node<n_prc_tot;node++){
+                for(pair=hearing_offsets[node];pair<hearing_offsets[node+1];pair++)
+                        heard_nodes[heard_offsets[hearing_nodes[pair]]++]=node;
+        }
+        for(node=n_prc_tot;node>0;node--)
+                heard_offsets[node]=heard_offsets[node-1];
+        heard_offsets[0]=0;
+
+        /*
+         * No slot is marked yet
+         */
+
+        for(slot=0;slot<n_prc_tot;slot++)
+                marks[slot]=UINT_MAX;
+
+        /*
+         * Color the nodes in order of ID
+         */
+
+        tdma_frame_length=0;
+        for(node=0;node<n_prc_tot;node++){
+
+                /*
+                 * Mark the slots of the nodes heard by the node, already colored
+                 */
+
+                for(pair=heard_offsets[node];pair<heard_offsets[node+1];pair++){
+                        other=heard_nodes[pair];
+                        if(other<node)
+                                marks[tdma_slots[other]]=node;
+                }
+
+                /*
+                 * Mark the slots of the nodes that can hear the node and of the nodes they can hear
+                 */
+
+                for(pair=hearing_offsets[node];pair<hearing_offsets[node+1];pair++){
+                        other=hearing_nodes[pair];
+                        if(other<node)
+                                marks[tdma_slots[other]]=node;
+                        for(second_pair=heard_offsets[other];second_pair<heard_offsets[other+1];second_pair++){
+                                third=heard_nodes[second_pair];
+                                if(third<node)
+                                        marks[tdma_slots[third]]=node;
+                        }
+                }
+
+                /*
+                 * Take the lowest slot that isn't marked
+                 */
+
+                for(slot=0;marks[slot]==node;slot++);
+                tdma_slots[node]=slot;
+                if(slot>=tdma_frame_length)
+                        tdma_frame_length=slot+1;
+        }
+
+        /*
+         * Release the memory used to color the nodes
+         */
+
+        free(audible);
+        free(hearing_offsets);
+        free(hearing_nodes);
+        free(heard_offsets);
+        free(heard_nodes);
+        free(marks);
+}
+
+/*
+ * START TDMA
+ *
+ * Schedule the transmission of the pending frame at the beginning of the next slot owned by the node: the channel is
+ * not sensed, since no other node that conflicts with this one transmits in the same slot
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static void start_tdma(node_state* state){
+
+        /*
+         * Length of a TDMA frame and time from the beginning of a frame to the beginning of the slot of the node
+         */
+
+        simtime_t frame_duration=tdma_frame_length*tdma_slot_duration;
+        simtime_t slot_offset=tdma_slots[state->me]*tdma_slot_duration;
+
+        /*
+         * Beginning of the first slot of the node not before the current time
+         */
+
+        simtime_t slot_start=ceil((state->lvt-slot_offset)/frame_duration)*frame_duration+slot_offset;
+        if(slot_start<state->lvt)
+                slot_start+=frame_duration;
+
+        /*
+         * Schedule the transmission of the frame at the beginning of the slot
+         */
+
+        wait_until(state->me,slot_start,START_FRAME_TRANSMISSION);
+}
+
 /*
  * START THE CSMA/CD PROTOCOL
  *
@@ -152,10 +581,10 @@ void start_csma(node_state* state){
 
         /*
          * Set the virtual time when the node will first check whether the channel is free: it has to wait a time equal
-         * to the backoff time
+         * to the backoff time (and, with LPL, for the recipient of a data packet to wake up)
          */
 
-        first_sample=state->lvt+backoff;
+        first_sample=get_sample_time(state,state->lvt,backoff);
 
         /*
          * Schedule a new event to tell this node to check whether the channel is free after the backoff time
@@ -164,6 +593,26 @@ void start_csma(node_state* state){
         wait_until(state->me,first_sample,CHECK_CHANNEL_FREE);
 }
 
+/*
+ * DRAW BACKOFF
+ *
+ * Return a new backoff time (in seconds): being n the number of backoffs already performed, it's a random value in the
+ * range
+ *
+ * [0,(CSM_HIGH-CSMA_LOW)*CSMA_EXPONENT_BASE^n]
+ *
+ * plus CSMA_LOW, divided by the number of symbols per second
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static simtime_t draw_backoff(node_state* state){
+        simtime_t backoff=RandomRange(0,(unsigned int)((csma_high-csma_low)*pow(csma_exponent_base,
+                                                                                state->backoff_count)));
+        backoff+=csma_init_low;
+        return backoff/(double)csma_symbols_per_sec;
+}
+
 /*
  * CHECK CHANNEL
  *
@@ -174,6 +623,9 @@ void start_csma(node_state* state){
  * as soon as this holds, or when CSMA_MAX_FREE_SAMPLES is set to zero, the node starts to transmit the frame.
  * In case the node sees that the channel is busy, it backs off, i.e. it recomputes the value of the backoff time and
  * schedules a new check when such a time has elapsed (unless the maximum number of backoffs has already been reached).
+ * If CSMA_SKIP_BUSY_SAMPLES is set, the checks falling before the channel may be free again are not scheduled: they
+ * would certainly find the channel busy, so the node backs off again at each of them, which is simulated by drawing all
+ * the corresponding backoffs at once
  *
  * @state: pointer to the object representing the current state of the node
  */
@@ -250,25 +702,38 @@ void check_channel(node_state* state){
                  * The link layer has not collected enough samples of the free channel yet => it backs again off and try
                  * again after a new backoff time or it drops the packet.
                  * If the number of backoffs already performed is below the limit (CSMA_MAX_FREE_SAMPLES) or if there's
-                 * no limit at all, the node backs off. This is the case here => being n the number of backoffs already
-                 * performed, calculate the new backoff time as random value in the range
-                 *
-                 * [0,(CSM_HIGH-CSMA_LOW)*CSMA_EXPONENT_BASE^n]
-                 *
-                 * and add it to CSMA_LOW.
-                 * Finally, multiple by the number of symbols per second
+                 * no limit at all, the node backs off. This is the case here => draw the new backoff time
+                 */
+
+                simtime_t next_sample=get_sample_time(state,state->lvt,draw_backoff(state));
+
+                /*
+                 * Time until which the channel is certainly busy
                  */
 
-                simtime_t backoff=RandomRange(0,(unsigned int)((csma_high-csma_low)*pow(csma_exponent_base,
-                                                                                        state->backoff_count)));
-                backoff+=csma_init_low;
-                backoff/=(double)csma_symbols_per_sec;
+                simtime_t busy_until;
+
+                /*
+                 * If busy samples are skipped, go through the samples falling before the channel may be free: at each
+                 * of them the node would find the channel busy and back off again, unless the limit of backoffs is
+                 * reached, in which case the sample is simulated, so the packet is dropped at the right time
+                 */
+
+                if(csma_skip_busy_samples){
+                        busy_until=get_channel_busy_until(state);
+                        while(next_sample<busy_until &&
+                              (!csma_max_free_samples || state->backoff_count<csma_max_free_samples)){
+                                state->backoff_count+=1;
+                                state->free_channel_count=(unsigned char)csma_min_free_samples;
+                                next_sample=get_sample_time(state,next_sample,draw_backoff(state));
+                        }
+                }
 
                 /*
                  * Schedule a new event to tell this node to check whether the channel is free after the backoff time
                  */
 
-                wait_until(state->me,state->lvt+backoff,CHECK_CHANNEL_FREE);
+                wait_until(state->me,next_sample,CHECK_CHANNEL_FREE);
         }
         else{
 
@@ -330,6 +795,16 @@ void start_frame_transmission(node_state* state){
 
         unsigned char type=state->link_layer_outgoing_type;
 
+        /*
+         * With TDMA, the channel has not been sensed: set the state of the link layer and of the radio to
+         * "transmitting" now (see "check_channel")
+         */
+
+        if(tdma){
+                state->link_layer_transmitting=true;
+                state->radio_state|=RADIO_TRANSMITTING;
+        }
+
         /*
          * Duration of the transmission of the frame, i.e. the time it takes for the neighbour nodes to successfully
          * receive a packet (including the time to transmit an acknowledgment, if required).
@@ -337,15 +812,15 @@ void start_frame_transmission(node_state* state){
          * and on the number of bytes of the acknowledgment frame (if it has to be sent) => it is generally referred to
          * as transmission delay; the propagation delay, i.e. the time it takes for the electromagnetic wave associated
          * to the signal to reach the recipient is negligible with respect to the transmission delay, so it is ignored.
-         * First get the length of the payload in bits (sizeof returns the length in bytes and 1 byte=8 bits): this
-         * depends on the size of the content of the frame, either a beacon or a data packet
+         * First get the length of the payload in bits (the length is given in bytes and 1 byte=8 bits): this depends on
+         * the content of the frame, either a beacon or a data packet
          */
 
         double bits_length;
         if(type==CTP_BEACON)
-                bits_length=sizeof(ctp_routing_packet)*8;
+                bits_length=CTP_BEACON_LENGTH*8;
         else
-                bits_length=sizeof(ctp_data_packet)*8;
+                bits_length=CTP_DATA_PACKET_LENGTH*8;
 
         /*
          * Then set the duration of the transmission to the number of symbols in the frame
@@ -397,6 +872,14 @@ void start_frame_transmission(node_state* state){
 
         duration+=csma_rxtx_delay/(double)csma_symbols_per_sec;
 
+        /*
+         * With LPL, a beacon is sent over and over for a whole wake interval, so that all the neighbours wake up while
+         * it's being sent
+         */
+
+        if(lpl_wake_interval && type==CTP_BEACON)
+                duration+=lpl_wake_interval;
+
         /*
          * Schedule a new event to signal that the transmission is finished and acknowledgment should have been received
          */
@@ -449,10 +932,13 @@ bool send_frame(node_state* state,unsigned char type){
         state->backoff_count=0;
 
         /*
-         * Start the CSMA/CD protocol
+         * Start the CSMA/CD protocol or, if TDMA is used, wait for the slot of the node
          */
 
-        start_csma(state);
+        if(tdma)
+                start_tdma(state);
+        else
+                start_csma(state);
 
         /*
          * The packet passed by above layers has been accepted by the link layer and will now be sent inside a link
@@ -612,5 +1098,5 @@ void frame_received(node_state* state,void* frame, unsigned char type){
  */
 
 bool compare_link_layer_frames(link_layer_frame* a,link_layer_frame* b){
-        return a->duration==b->duration && a->gain==b->gain && a->sink==b->sink && a->src==b->src;
+        return a->duration==b->duration && a->gain==b->gain && a->sink==b->sink && a->src==b->src && a->seq==b->seq;
 }
\ No newline at end of file
@@ -108,10 +108,84 @@
 #define CSMA_SENSITIVITY 4
 #endif
 
+/*
+ * If true, when the channel is busy the node doesn't check it again until the transmissions it is sensing make it
+ * certainly busy: the backoffs falling in the meantime are drawn at once, without scheduling an event for each of them
+ */
+
+#ifndef CSMA_SKIP_BUSY_SAMPLES
+#define CSMA_SKIP_BUSY_SAMPLES 0
+#endif
+
+/*
+ * Length (in bytes) of a frame containing a beacon and of a frame containing a data packet, excluding the preamble.
+ * These are used to compute the time it takes to transmit a frame: they are fixed, rather than given by the size of the
+ * corresponding data structures, because the latter also contain fields that are only needed by the simulation (e.g.
+ * the gain of the link or the sequence number of the transmission)
+ */
+
+#ifndef CTP_BEACON_LENGTH
+#define CTP_BEACON_LENGTH 40
+#endif
+
+#ifndef CTP_DATA_PACKET_LENGTH
+#define CTP_DATA_PACKET_LENGTH 40
+#endif
+
 /*
  * PARAMETERS OF THE CARRIER SENSE MULTIPLE ACCESS PROTOCOL (CSMA) - end
  */
 
+/*
+ * PARAMETERS OF THE LOW POWER LISTENING (LPL) - start
+ */
+
+/*
+ * Time (in seconds) between two consecutive wake-ups of the radio of a node: if zero, the radio is always on
+ */
+
+#ifndef LPL_WAKE_INTERVAL
+#define LPL_WAKE_INTERVAL 0
+#endif
+
+/*
+ * Time (in seconds) the radio of a node stays on at each wake-up to check whether a frame is coming
+ */
+
+#ifndef LPL_CHECK_DURATION
+#define LPL_CHECK_DURATION 0.01
+#endif
+
+/*
+ * PARAMETERS OF THE LOW POWER LISTENING (LPL) - end
+ */
+
+/*
+ * PARAMETERS OF THE TIME DIVISION MULTIPLE ACCESS (TDMA) - start
+ */
+
+/*
+ * If true, the nodes use TDMA instead of CSMA: each node owns a slot of a periodic frame and transmits only at the
+ * beginning of its slot, without sensing the channel
+ */
+
+#ifndef TDMA
+#define TDMA 0
+#endif
+
+/*
+ * Length (in seconds) of a TDMA slot: if zero, it's the time it takes to transmit the longest frame, including the
+ * acknowledgment and the switch of the radio from transmission to reception
+ */
+
+#ifndef TDMA_SLOT_DURATION
+#define TDMA_SLOT_DURATION 0
+#endif
+
+/*
+ * PARAMETERS OF THE TIME DIVISION MULTIPLE ACCESS (TDMA) - end
+ */
+
 void start_frame_transmission(node_state* state);
 bool send_frame(node_state* state,unsigned char type);
 void frame_transmitted(node_state* state);
@@ -120,4 +194,9 @@ void check_channel(node_state* state);
 void init_link_layer(node_state* state);
 void parse_link_layer_parameters(void* event_content);
 bool compare_link_layer_frames(link_layer_frame* a,link_layer_frame* b);
+bool is_radio_awake(unsigned int node,simtime_t time);
+simtime_t get_next_wake_up(unsigned int node,simtime_t time);
+bool get_reception_start(unsigned int sink,unsigned char type,simtime_t start,simtime_t duration,
+                         simtime_t* reception);
+void build_tdma_schedule();
 #endif //SENSORSNETWORKMODELPROJECT_LINK_LAYER_H
@@ -0,0 +1,517 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "noise_model.h"
+#include "power_conversion.h"
+
+/*
+ * NOISE MODEL
+ *
+ * Noise taken from a trace of real measurements, with the Closest Pattern Matching (CPM) model of TOSSIM: the noise
+ * sensed by a node is a sequence of samples where the next sample only depends on the last NOISE_HISTORY ones, and its
+ * distribution is given by the trace => for each sequence of NOISE_HISTORY samples found in the trace (a pattern), the
+ * samples that follow it in the trace are collected, and the next sample of a node is drawn among the ones following
+ * its last samples. This reproduces the bursts of noise and the correlation between consecutive samples of real
+ * environments, unlike the uniform noise of "get_current_noise".
+ * The trace is a text file with a sample (in dBm) per line, like the files in the folder "noise" of TOSSIM: it's shared
+ * by all the nodes, while each node has its own history, starting at a random position of the trace.
+ * The patterns are stored in a hash table with open addressing: the hash of the last samples of a node is updated at
+ * each new sample without going through the whole history (rolling hash), so a sample only costs a lookup in the table
+ * and a random draw
+ */
+
+/* GLOBAL VARIABLES - start
+ *
+ * Default values of the parameters for the noise model (check noise_model.h for a description)
+ */
+
+unsigned int noise_history=NOISE_HISTORY;
+unsigned int noise_index_memory=NOISE_INDEX_MEMORY;
+
+/* GLOBAL VARIABLES - end */
+
+/*
+ * TRACE NOISE
+ *
+ * Boolean value telling whether the noise is taken from a trace, rather than drawn from the uniform distribution
+ */
+
+bool trace_noise=false;
+
+/*
+ * TRACE
+ *
+ * Dynamically allocated array with the samples of the trace, each one stored as the difference from the lowest sample
+ * of the trace ("trace_min", in dBm), and the number of samples
+ */
+
+unsigned char* trace=NULL;
+unsigned int trace_length=0;
+int trace_min;
+
+/*
+ * Value in mW of each sample of the trace, indexed by the difference from the lowest sample
+ */
+
+double trace_mw[UCHAR_MAX+1];
+
+/*
+ * INDEX OF THE PATTERNS
+ *
+ * Hash table of the patterns of the trace (the number of elements is a power of 2, "patterns_mask" is the number of
+ * elements minus 1) and array of the samples following the patterns, grouped by pattern
+ */
+
+noise_pattern* patterns=NULL;
+unsigned long patterns_mask;
+unsigned char* next_samples=NULL;
+
+/*
+ * Value of NOISE_HASH_BASE to the power of NOISE_HISTORY-1, used to remove the oldest sample from the hash of a
+ * sequence of samples
+ */
+
+uint64_t oldest_sample_factor;
+
+/*
+ * PATTERN OCCURRENCE
+ *
+ * An occurrence of a pattern in the trace, with the sample that follows it: it's only used to build the index
+ */
+
+typedef struct _pattern_occurrence{
+        uint64_t hash; // Hash of the pattern
+        unsigned char next_sample; // Sample following the pattern
+}pattern_occurrence;
+
+/*
+ * PARSE SIMULATION PARAMETERS FOR THE NOISE MODEL
+ */
+
+void parse_noise_model_parameters(void* event_content){
+
+        if(IsParameterPresent(event_content, "noise_history"))
+                noise_history=(unsigned int)GetParameterInt(event_content,"noise_history");
+        if(IsParameterPresent(event_content, "noise_index_memory"))
+                noise_index_memory=(unsigned int)GetParameterInt(event_content,"noise_index_memory");
+
+        /*
+         * Check that the history fits in the state of the nodes: if not, abort
+         */
+
+        if(!noise_history || noise_history>NOISE_HISTORY_SIZE){
+                printf("[FATAL ERROR] The parameter \"noise_history\" has to be between 1 and %d\n",NOISE_HISTORY_SIZE);
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * ADD SAMPLE TO HASH
+ *
+ * Return the hash of a sequence of samples after the given sample is appended to it and, if the sequence is full, the
+ * oldest sample is removed
+ *
+ * @hash: hash of the sequence of samples
+ * @oldest_sample: oldest sample of the sequence, or -1 if the sequence is not full
+ * @sample: the sample appended
+ */
+
+static uint64_t add_sample_to_hash(uint64_t hash,int oldest_sample,unsigned char sample){
+        if(oldest_sample>=0)
+                hash-=(uint64_t)(oldest_sample+1)*oldest_sample_factor;
+        return hash*NOISE_HASH_BASE+sample+1;
+}
+
+/*
+ * GET PATTERN SLOT
+ *
+ * Return the position of the pattern with the given hash in the hash table of the patterns or, if there's no such
+ * pattern, the position of the empty element where it would be stored
+ *
+ * @hash: hash of the pattern
+ */
+
+static unsigned long get_pattern_slot(uint64_t hash){
+
+        /*
+         * Start from the position given by the hash, with its bits mixed so that also the highest ones count, and go
+         * on until the pattern or an empty element is found
+         */
+
+        unsigned long slot=(unsigned long)((hash^(hash>>29))*0xbf58476d1ce4e5b9ULL>>32)&patterns_mask;
+
+        while(patterns[slot].count && patterns[slot].hash!=hash)
+                slot=(slot+1)&patterns_mask;
+        return slot;
+}
+
+/*
+ * COMPARE OCCURRENCES
+ *
+ * Comparison function used to sort the occurrences of the patterns by hash, and then by the sample following them
+ */
+
+static int compare_occurrences(const void* first,const void* second){
+        const pattern_occurrence* a=first;
+        const pattern_occurrence* b=second;
+
+        if(a->hash!=b->hash)
+                return a->hash<b->hash?-1:1;
+        return (int)a->next_sample-(int)b->next_sample;
+}
+
+/*
+ * BUILD NOISE INDEX
+ *
+ * Build the index of the patterns of the trace, with the current value of "noise_history": the occurrences of the
+ * patterns are collected and sorted by hash, then each distinct pattern is stored in the hash table, which has at least
+ * twice as many elements as the patterns.
+ * If the index would take more than "noise_index_memory" KB, nothing is stored
+ *
+ * Returns true if the index has been built, false otherwise
+ */
+
+static bool build_noise_index(){
+
+        /*
+         * Occurrences of the patterns, their number and the number of distinct patterns
+         */
+
+        pattern_occurrence* occurrences;
+        unsigned int occurrences_count=trace_length-noise_history;
+        unsigned int distinct=0;
+
+        /*
+         * Number of elements of the hash table
+         */
+
+        unsigned long size=1;
+
+        /*
+         * Hash of the current pattern
+         */
+
+        uint64_t hash=0;
+
+        /*
+         * Index variables
+         */
+
+        unsigned int index;
+        unsigned long slot;
+
+        /*
+         * Compute the factor of the oldest sample of a pattern
+         */
+
+        oldest_sample_factor=1;
+        for(index=1;index<noise_history;index++)
+                oldest_sample_factor*=NOISE_HASH_BASE;
+
+        /*
+         * Collect the occurrences: the hash of the pattern ending before each sample is updated by removing the oldest
+         * sample and adding the newest one
+         */
+
+        occurrences=malloc(sizeof(pattern_occurrence)*occurrences_count);
+        if(!occurrences){
+                printf("[FATAL ERROR] Not enough memory to store the patterns of the noise trace\n");
+                exit(EXIT_FAILURE);
+        }
+        for(index=0;index<noise_history;index++)
+                hash=add_sample_to_hash(hash,-1,trace[index]);
+        for(index=noise_history;index<trace_length;index++){
+                occurrences[index-noise_history].hash=hash;
+                occurrences[index-noise_history].next_sample=trace[index];
+                hash=add_sample_to_hash(hash,trace[index-noise_history],trace[index]);
+        }
+
+        /*
+         * Sort the occurrences and count the distinct patterns
+         */
+
+        qsort(occurrences,occurrences_count,sizeof(pattern_occurrence),compare_occurrences);
+        for(index=0;index<occurrences_count;index++){
+                if(!index || occurrences[index].hash!=occurrences[index-1].hash)
+                        distinct++;
+        }
+
+        /*
+         * Check that the index fits in the given memory: if not, give up
+         */
+
+        while(size<2*(unsigned long)distinct)
+                size*=2;
+        if(size*sizeof(noise_pattern)+occurrences_count>(unsigned long)noise_index_memory*1024){
+                free(occurrences);
+                return false;
+        }
+
+        /*
+         * Allocate the index, with all the elements of the hash table empty
+         */
+
+        patterns=calloc(size,sizeof(noise_pattern));
+        next_samples=malloc(occurrences_count);
+        if(!patterns || !next_samples){
+                printf("[FATAL ERROR] Not enough memory to store the patterns of the noise trace\n");
+                exit(EXIT_FAILURE);
+        }
+        patterns_mask=size-1;
+
+        /*
+         * Store the samples following the patterns in order and each distinct pattern in the hash table
+         */
+
+        for(index=0;index<occurrences_count;index++){
+                next_samples[index]=occurrences[index].next_sample;
+                if(!index || occurrences[index].hash!=occurrences[index-1].hash){
+                        slot=get_pattern_slot(occurrences[index].hash);
+                        patterns[slot].hash=occurrences[index].hash;
+                        patterns[slot].first=index;
+                }
+                patterns[slot].count++;
+        }
+
+        free(occurrences);
+        return true;
+}
+
+/*
+ * READ NOISE TRACE
+ *
+ * Read the trace of the noise from the given file, which contains a sample (in dBm) per line: the samples are rounded
+ * to integer values and the difference between the highest and the lowest one can't be more than 255 dBm. A comma is
+ * accepted as decimal separator as well.
+ * Then the index of the patterns of the trace is built: if it doesn't fit in "noise_index_memory" KB, the number of past
+ * samples determining the next one is decreased until it does. From now on, the noise of the nodes is taken from the
+ * trace
+ *
+ * @path: filename of the file
+ */
+
+void read_noise_trace(const char* path){
+
+        /*
+         * Samples read from the file (in dBm), the number of elements allocated and the highest sample
+         */
+
+        int* samples=NULL;
+        unsigned int capacity=0;
+        int trace_max=0;
+
+        /*
+         * Buffer for the line and its size, allocated by "getline"
+         */
+
+        size_t len=0;
+        char* lineptr=NULL;
+
+        /*
+         * Number of past samples requested
+         */
+
+        unsigned int requested_history=noise_history;
+
+        /*
+         * Index variable
+         */
+
+        unsigned int index;
+
+        /*
+         * Open the file
+         */
+
+        FILE* trace_file=fopen(path,"r");
+        if(!trace_file){
+                printf("[FATAL ERROR] Provided path doesn't correspond to any file or it cannot be accessed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Read the samples, skipping empty lines
+         */
+
+        while(getline(&lineptr,&len,trace_file)!=-1){
+
+                /*
+                 * The sample and the pointer to the comma in the line
+                 */
+
+                double sample;
+                char* comma=strchr(lineptr,',');
+
+                if(comma)
+                        *comma='.';
+                if(sscanf(lineptr,"%lf",&sample)!=1)
+                        continue;
+
+                /*
+                 * Make room for the sample, doubling the array if it's full
+                 */
+
+                if(trace_length==capacity){
+                        capacity=capacity?capacity*2:1024;
+                        samples=realloc(samples,sizeof(int)*capacity);
+                        if(!samples){
+                                printf("[FATAL ERROR] Not enough memory to store the noise trace\n");
+                                exit(EXIT_FAILURE);
+                        }
+                }
+                samples[trace_length]=(int)lround(sample);
+                if(!trace_length || samples[trace_length]<trace_min)
+                        trace_min=samples[trace_length];
+                if(!trace_length || samples[trace_length]>trace_max)
+                        trace_max=samples[trace_length];
+                trace_length++;
+        }
+        free(lineptr);
+        fclose(trace_file);
+
+        /*
+         * Check that the trace is longer than the history and that the samples fit in a byte: if not, abort
+         */
+
+        if(trace_length<=noise_history){
+                printf("[FATAL ERROR] The noise trace has to contain more than %u samples\n",noise_history);
+                exit(EXIT_FAILURE);
+        }
+        if(trace_max-trace_min>UCHAR_MAX){
+                printf("[FATAL ERROR] The samples of the noise trace span more than %d dBm\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Store the samples as differences from the lowest one and convert each possible value to mW
+         */
+
+        trace=malloc(trace_length);
+        if(!trace){
+                printf("[FATAL ERROR] Not enough memory to store the noise trace\n");
+                exit(EXIT_FAILURE);
+        }
+        for(index=0;index<trace_length;index++)
+                trace[index]=(unsigned char)(samples[index]-trace_min);
+        free(samples);
+        for(index=0;index<=UCHAR_MAX;index++)
+                trace_mw[index]=dbm_to_mw(trace_min+(int)index);
+
+        /*
+         * Build the index, shortening the history until it fits in memory
+         */
+
+        while(!build_noise_index()){
+                if(noise_history==1){
+                        printf("[FATAL ERROR] The noise trace is too long for %u KB of memory\n",noise_index_memory);
+                        exit(EXIT_FAILURE);
+                }
+                noise_history--;
+        }
+        if(noise_history!=requested_history)
+                printf("The noise index doesn't fit in %u KB: the noise is determined by the last %u samples\n",
+                       noise_index_memory,noise_history);
+
+        trace_noise=true;
+}
+
+/*
+ * INIT NOISE HISTORY
+ *
+ * Fill the history of the noise of the given node with the samples of the trace starting at a random position: the
+ * position is chosen so that at least a sample follows them in the trace
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+void init_noise_history(node_state* state){
+
+        /*
+         * Position of the first sample in the trace
+         */
+
+        unsigned int start=(unsigned int)(Random()*(trace_length-noise_history));
+
+        /*
+         * Index of the sample
+         */
+
+        unsigned int index;
+
+        if(start>=trace_length-noise_history)
+                start=trace_length-noise_history-1;
+        state->noise_history_hash=0;
+        for(index=0;index<noise_history;index++){
+                state->noise_history[index]=trace[start+index];
+                state->noise_history_hash=add_sample_to_hash(state->noise_history_hash,-1,trace[start+index]);
+        }
+        state->noise_history_position=0;
+}
+
+/*
+ * SAMPLE NOISE
+ *
+ * Return the next sample of the noise sensed by the given node (in mW): it's drawn among the samples that follow the
+ * last samples of the node in the trace, and then it's added to the history of the node.
+ * If the last samples of the node are only found at the end of the trace, no sample follows them => the history is
+ * started again from a random position of the trace
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+double sample_noise(node_state* state){
+
+        /*
+         * Pattern of the last samples of the node
+         */
+
+        noise_pattern* pattern=&patterns[get_pattern_slot(state->noise_history_hash)];
+
+        /*
+         * Position of the sample drawn among the ones following the pattern, and the sample
+         */
+
+        unsigned int position;
+        unsigned char sample;
+
+        /*
+         * If the pattern is not in the index, start again
+         */
+
+        if(!pattern->count){
+                init_noise_history(state);
+                pattern=&patterns[get_pattern_slot(state->noise_history_hash)];
+        }
+
+        /*
+         * Draw the sample
+         */
+
+        position=(unsigned int)(Random()*pattern->count);
+        if(position>=pattern->count)
+                position=pattern->count-1;
+        sample=next_samples[pattern->first+position];
+
+        /*
+         * Replace the oldest sample of the history with the new one
+         */
+
+        state->noise_history_hash=add_sample_to_hash(state->noise_history_hash,
+                                                     state->noise_history[state->noise_history_position],sample);
+        state->noise_history[state->noise_history_position]=sample;
+        state->noise_history_position=(unsigned char)((state->noise_history_position+1)%noise_history);
+
+        return trace_mw[sample];
+}
+
+/*
+ * GET LOWEST TRACE NOISE
+ *
+ * Return the lowest sample of the trace (in dBm)
+ */
+
+double get_lowest_trace_noise(){
+        return trace_min;
+}
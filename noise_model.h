@@ -0,0 +1,58 @@
+#ifndef SENSORSNETWORKMODELPROJECT_NOISE_MODEL_H
+#define SENSORSNETWORKMODELPROJECT_NOISE_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "application.h"
+
+/*
+ * NOISE MODEL PARAMETERS' DEFAULT VALUES
+ *
+ * They are used only if a trace of the noise is given (see "noise_model.c")
+ */
+
+/*
+ * Number of past samples of the noise that determine the distribution of the next one: it can't be bigger than
+ * NOISE_HISTORY_SIZE. The value of TOSSIM is 20
+ */
+
+#ifndef NOISE_HISTORY
+#define NOISE_HISTORY 20
+#endif
+
+/*
+ * Highest amount of memory (in KB) taken by the index of the patterns of the trace: if the index doesn't fit, the
+ * number of past samples is decreased until it does
+ */
+
+#ifndef NOISE_INDEX_MEMORY
+#define NOISE_INDEX_MEMORY 16384
+#endif
+
+/*
+ * Base of the polynomial hash of the sequences of samples
+ */
+
+#ifndef NOISE_HASH_BASE
+#define NOISE_HASH_BASE 0x100000001b3ULL
+#endif
+
+/*
+ * NOISE PATTERN
+ *
+ * A sequence of samples found in the trace (a pattern) and the samples that follow it in the trace: these are stored
+ * contiguously, from position "first" to position "first+count" (excluded) of the array of the next samples
+ */
+
+typedef struct _noise_pattern{
+        uint64_t hash; // Hash of the sequence of samples
+        unsigned int first; // Position of the first sample following the pattern
+        unsigned int count; // Number of samples following the pattern (0 if the element of the index is empty)
+}noise_pattern;
+
+void parse_noise_model_parameters(void* event_content);
+void read_noise_trace(const char* path);
+void init_noise_history(node_state* state);
+double sample_noise(node_state* state);
+double get_lowest_trace_noise();
+#endif //SENSORSNETWORKMODELPROJECT_NOISE_MODEL_H
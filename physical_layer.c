@@ -1,6 +1,15 @@
 #include <math.h>
+#include <limits.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "physical_layer.h"
 #include "link_layer.h"
+#include "power_conversion.h"
+#include "channel_model.h"
+#include "topology_format.h"
+#include "noise_model.h"
 
 /*
  * PHYSICAL LAYER MODEL
@@ -27,23 +36,75 @@
 
 double white_noise_mean=WHITE_NOISE_MEAN;
 double channel_free_threshold=CHANNEL_FREE_THRESHOLD;
+bool sparse_topology=SPARSE_TOPOLOGY;
+double audibility_margin=AUDIBILITY_MARGIN;
+bool symmetric_gains=SYMMETRIC_GAINS;
+unsigned char reception_model=RECEPTION_MODEL;
+bool far_field_aggregation=FAR_FIELD_AGGREGATION;
+double far_field_threshold=FAR_FIELD_THRESHOLD;
+double far_field_activity=FAR_FIELD_ACTIVITY;
+unsigned int pending_transmissions_pool_size=PENDING_TRANSMISSIONS_POOL_SIZE;
+
+/*
+ * Values of the parameters above in linear units (see "convert_physical_layer_parameters"): the power of the signals is
+ * summed and compared in mW, so the thresholds are converted only once
+ */
+
+double channel_free_threshold_mw; // Value of "channel_free_threshold" in mW
+double reception_ratio; // Ratio between the power of two signals corresponding to the SINR of "get_reception_sinr"
+
+/*
+ * FAR FIELD
+ *
+ * Dynamically allocated array containing, for each node, the background power (in mW) that replaces the transmissions
+ * not delivered to the node because the gain of their link is below "far_field_threshold" (see "get_delivery_cutoff")
+ */
+
+double* far_field_mw=NULL;
+
+/*
+ * PRR TABLE
+ *
+ * Packet reception ratio of the CC2420 radio for a frame containing a beacon (first row) and for a frame containing a
+ * data packet (second row), for each of the values of the SINR in the table (see "build_prr_table")
+ */
+
+double prr_table[2][PRR_TABLE_SIZE];
 
 /* GLOBAL VARIABLES - end */
 
 extern double csma_sensitivity;
 extern node_statistics* node_statistics_list;
+extern bool procedural_channel;
+extern bool grid_enabled;
+extern bool trace_noise;
+extern spatial_grid grid;
+extern double mean_shadowing_gain;
 typedef struct _pending_transmission pending_transmission;
 
 /*
- * GAIN ADJACENCY LIST
+ * GAIN TABLE
+ *
+ * Table containing the gain of all the wireless links of the network, in Compressed Sparse Row format (see the
+ * definition of "gain_table"): the links of each node are stored contiguously, so the sender of a frame only has to
+ * scan a contiguous range of two arrays to reach all its neighbors.
+ * This data structure is built before the simulation starts, reading the values for the gain from the INPUT FILE.
+ */
+
+gain_table gains_table;
+
+/*
+ * LIST OF THE LINKS READ FROM THE INPUT FILE
  *
- * Array of unsorted lists, one for each node: the list contains the gain of all the wireless links having the node as
- * source node.
- * This data structure is dynamically allocated before the simulation starts, reading the values for the gain from the
- * INPUT FILE.
+ * Dynamically allocated array of the links read from the INPUT FILE, in the order they are read: it's only used to
+ * build the gain table and it is released as soon as the table is ready.
+ * The array grows as new links are read => "gain_entries_count" is the number of links read so far, while
+ * "gain_entries_capacity" is the number of elements allocated
  */
 
-gain_entry** gains_list=NULL;
+gain_entry* gain_entries=NULL;
+unsigned long gain_entries_count=0;
+unsigned long gain_entries_capacity=0;
 
 /*
  * NOISE FLOOR LIST
@@ -56,6 +117,34 @@ gain_entry** gains_list=NULL;
 
 noise_entry* noise_list=NULL;
 
+/*
+ * NOISE FLOOR IN LINEAR UNITS
+ *
+ * Dynamically allocated array containing, for each node, the static component of its noise plus the mean value of the
+ * dynamic component, in mW: each node converts its own value when it is initialized (see "init_node_noise")
+ */
+
+double* noise_floor_mw=NULL;
+
+/*
+ * BROADCAST BUFFER
+ *
+ * Dynamically allocated array of BROADCAST_BUFFER_DEPTH slots for each node, where the node stores the frames it
+ * transmits (see "broadcast_frame"): the frame with sequence number "seq" transmitted by node "i" is stored in the slot
+ * i*BROADCAST_BUFFER_DEPTH+seq%BROADCAST_BUFFER_DEPTH
+ */
+
+broadcast_frame* broadcast_buffer=NULL;
+
+/*
+ * COMMITTED TRANSMISSIONS
+ *
+ * Dynamically allocated array containing, for each node, the number of transmissions it has performed as of the last
+ * GVT: it's updated in "OnGVT" and tells which slots of the broadcast buffer can be reused (see "store_broadcast_frame")
+ */
+
+unsigned int* committed_transmissions=NULL;
+
 extern FILE* file;
 
 /*
@@ -68,6 +157,64 @@ void parse_physical_layer_parameters(void* event_content){
                 white_noise_mean=GetParameterDouble(event_content,"white_noise_mean");
         if(IsParameterPresent(event_content, "channel_free_threshold"))
                 channel_free_threshold=GetParameterDouble(event_content,"channel_free_threshold");
+        if(IsParameterPresent(event_content, "sparse_topology"))
+                sparse_topology=GetParameterInt(event_content,"sparse_topology")!=0;
+        if(IsParameterPresent(event_content, "audibility_margin"))
+                audibility_margin=GetParameterDouble(event_content,"audibility_margin");
+        if(IsParameterPresent(event_content, "reception_model"))
+                reception_model=(unsigned char)GetParameterInt(event_content,"reception_model");
+        if(IsParameterPresent(event_content, "symmetric_gains"))
+                symmetric_gains=GetParameterInt(event_content,"symmetric_gains")!=0;
+        if(IsParameterPresent(event_content, "far_field_aggregation"))
+                far_field_aggregation=GetParameterInt(event_content,"far_field_aggregation")!=0;
+        if(IsParameterPresent(event_content, "far_field_threshold"))
+                far_field_threshold=GetParameterDouble(event_content,"far_field_threshold");
+        if(IsParameterPresent(event_content, "far_field_activity"))
+                far_field_activity=GetParameterDouble(event_content,"far_field_activity");
+        if(IsParameterPresent(event_content, "pending_transmissions_pool_size"))
+                pending_transmissions_pool_size=(unsigned int)GetParameterInt(event_content,
+                                                                              "pending_transmissions_pool_size");
+
+        /*
+         * The size of the pool of pending transmissions has to fit the indexes of its slots, NO_PENDING_TRANSMISSION
+         * excluded
+         */
+
+        if(!pending_transmissions_pool_size || pending_transmissions_pool_size>=NO_PENDING_TRANSMISSION){
+                printf("[FATAL ERROR] The size of the pool of pending transmissions has to be between 1 and %d\n",
+                       NO_PENDING_TRANSMISSION-1);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the activity of the nodes is a fraction of time: if not, abort
+         */
+
+        if(far_field_activity<0 || far_field_activity>1){
+                printf("[FATAL ERROR] The parameter \"far_field_activity\" has to be in the range [0,1]\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the gains are not symmetric if the topology is sparse: the gains of the pairs take room for all the
+         * pairs of nodes and a frame is sent checking all of them, so a sparse topology would lose the benefit of
+         * dropping the links that are not audible
+         */
+
+        if(symmetric_gains && sparse_topology){
+                printf("[FATAL ERROR] The parameters \"symmetric_gains\" and \"sparse_topology\" can't be both given\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the reception model is known: if not, abort
+         */
+
+        if(reception_model!=RECEPTION_THRESHOLD && reception_model!=RECEPTION_PRR){
+                printf("[FATAL ERROR] The parameter \"reception_model\" has to be either %d or %d\n",
+                       RECEPTION_THRESHOLD,RECEPTION_PRR);
+                exit(EXIT_FAILURE);
+        }
 }
 
 /*
@@ -93,39 +240,190 @@ void init_physical_layer(node_state* state){
         state->pending_transmissions_power=0;
 
         /*
-         * Set the list containing pending transmissions to NULL
+         * Index of the slot of the pool of pending transmissions
+         */
+
+        unsigned char slot;
+
+        /*
+         * There are no pending transmissions
+         */
+
+        state->pending_transmissions=0;
+
+        /*
+         * All the slots of the pool are free => link each slot to the following one in the list of free slots
+         */
+
+        for(slot=0;slot<pending_transmissions_pool_size;slot++)
+                state->pending_transmissions_pool[slot].next=slot+1<pending_transmissions_pool_size?
+                                                             slot+1:NO_PENDING_TRANSMISSION;
+        state->free_pending_transmissions=0;
+
+        /*
+         * If the noise is taken from a trace, start the history of the noise of the node
+         */
+
+        if(trace_noise)
+                init_noise_history(state);
+}
+
+/*
+ * MARK LOST TRANSMISSIONS
+ *
+ * Set the lost flag of the in-flight transmissions, starting from the given position, whose signal is weaker than the
+ * given threshold: they are hidden by a stronger signal.
+ * The strengths are compared two at a time with SSE2 instructions, if available, so a node sensing many transmissions
+ * doesn't pay a branch for each of them
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @first: position of the first transmission to check
+ * @threshold: strength (in mW) below which a transmission is lost
+ */
+
+static void mark_lost_transmissions(node_state* state,unsigned int first,double threshold){
+
+        /*
+         * Position of the current transmission
+         */
+
+        unsigned int position=first;
+
+#ifdef __SSE2__
+
+        /*
+         * Threshold copied in both the lanes of a vector
+         */
+
+        __m128d limit=_mm_set1_pd(threshold);
+
+        /*
+         * Mask of the comparisons of two strengths against the threshold
+         */
+
+        int mask;
+
+        /*
+         * Compare two strengths at a time and merge the result into their lost flags
+         */
+
+        for(;position+2<=state->pending_transmissions;position+=2){
+                mask=_mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(&state->pending_transmissions_powers[position]),limit));
+                state->pending_transmissions_lost[position]|=mask&1;
+                state->pending_transmissions_lost[position+1]|=mask>>1;
+        }
+#endif
+
+        /*
+         * Compare the remaining strength, if any
+         */
+
+        for(;position<state->pending_transmissions;position++)
+                state->pending_transmissions_lost[position]|=state->pending_transmissions_powers[position]<threshold;
+}
+
+/*
+ * COUNT TRANSMISSIONS FINISHING BY
+ *
+ * Return the number of in-flight transmissions finishing not later than the given time: since they are sorted by end
+ * time, this is also the position where a transmission finishing at that time has to be inserted.
+ * The end times are compared two at a time with SSE2 instructions, if available
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @end: the time
+ */
+
+static unsigned char count_transmissions_finishing_by(node_state* state,simtime_t end){
+
+        /*
+         * Position of the current transmission
+         */
+
+        unsigned int position=0;
+
+        /*
+         * Number of transmissions finishing not later than the given time
+         */
+
+        unsigned char count=0;
+
+#ifdef __SSE2__
+
+        /*
+         * Time copied in both the lanes of a vector
+         */
+
+        __m128d limit=_mm_set1_pd(end);
+
+        /*
+         * Mask of the comparisons of two end times against the given time
+         */
+
+        int mask;
+
+        /*
+         * Compare two end times at a time and add the number of those not later than the given time
+         */
+
+        for(;position+2<=state->pending_transmissions;position+=2){
+                mask=_mm_movemask_pd(_mm_cmple_pd(_mm_loadu_pd(&state->pending_transmissions_ends[position]),limit));
+                count+=(mask&1)+(mask>>1);
+        }
+#endif
+
+        /*
+         * Compare the remaining end time, if any
          */
 
-        state->pending_transmissions=NULL;
+        for(;position<state->pending_transmissions;position++)
+                count+=state->pending_transmissions_ends[position]<=end;
+        return count;
 }
 
 /*
  * CREATE PENDING TRANSMISSION
  *
- * Create a new instance of type "pending_transmission" to keep track of a new pending transmission
+ * Take a free slot from the pool of pending transmissions of the node, copy the frame into it and add the transmission
+ * to the in-flight ones, after all those finishing not later than it; the caller has to check that a slot is free
  *
+ * @state: pointer to the object representing the current state of the node
  * @type: byte telling whether the frame contains a beacon or a data packet
  * @frame: pointer to the frame carried by the signal
  * @power: power of the signal
  * @lost: boolean variable set to true if the transmission won't be received by the recipient, either because too
  *        weak or because the node is busy receiving/transmitting
+ * @end: time when the transmission finishes
  *
- * Returns the address of the new instance
+ * Returns the index of the slot
  */
 
-pending_transmission* create_pending_transmission(unsigned char type,void* frame, double power,bool lost){
+unsigned char create_pending_transmission(node_state* state,unsigned char type,void* frame, double power,bool lost,
+                                          simtime_t end){
+
+        /*
+         * Get the first free slot of the pool
+         */
+
+        unsigned char slot=state->free_pending_transmissions;
+
+        /*
+         * Pointer to the slot
+         */
+
+        pending_transmission* new_transmission;
 
         /*
-         * Allocate a new instance of type "pending_transmission"
+         * Position of the new transmission in the arrays of the in-flight transmissions
          */
 
-        pending_transmission* new_transmission=(pending_transmission*)malloc(sizeof(pending_transmission));
+        unsigned char position;
 
         /*
-         * Set to zero the allocated buffer
+         * Remove the slot from the list of free slots
          */
 
-        bzero(new_transmission,sizeof(pending_transmission));
+        new_transmission=&state->pending_transmissions_pool[slot];
+        state->free_pending_transmissions=new_transmission->next;
 
         /*
          * Parse the content of the frame
@@ -153,6 +451,7 @@ pending_transmission* create_pending_transmission(unsigned char type,void* frame
                 new_transmission->frame.routing_packet.link_frame.gain=beacon->link_frame.gain;
                 new_transmission->frame.routing_packet.link_frame.sink=beacon->link_frame.sink;
                 new_transmission->frame.routing_packet.link_frame.src=beacon->link_frame.src;
+                new_transmission->frame.routing_packet.link_frame.seq=beacon->link_frame.seq;
                 new_transmission->frame.routing_packet.link_estimator_frame.seq=beacon->link_estimator_frame.seq;
                 new_transmission->frame.routing_packet.routing_frame.ETX=beacon->routing_frame.ETX;
                 new_transmission->frame.routing_packet.routing_frame.options=beacon->routing_frame.options;
@@ -178,6 +477,7 @@ pending_transmission* create_pending_transmission(unsigned char type,void* frame
 
                 new_transmission->frame.data_packet.link_frame.sink=data_packet->link_frame.sink;
                 new_transmission->frame.data_packet.link_frame.src=data_packet->link_frame.src;
+                new_transmission->frame.data_packet.link_frame.seq=data_packet->link_frame.seq;
                 new_transmission->frame.data_packet.link_frame.duration=data_packet->link_frame.duration;
                 new_transmission->frame.data_packet.link_frame.gain=data_packet->link_frame.gain;
                 new_transmission->frame.data_packet.payload=data_packet->payload;
@@ -189,34 +489,79 @@ pending_transmission* create_pending_transmission(unsigned char type,void* frame
         }
 
         /*
-         * Set the flag indicating whether the frame has been lost or not
+         * The in-flight transmissions are sorted by end time => the new one goes after all those finishing not later
+         * than it: shift the following ones by one position to make room for it
          */
 
-        new_transmission->lost=lost;
+        position=count_transmissions_finishing_by(state,end);
+        memmove(&state->pending_transmissions_powers[position+1],&state->pending_transmissions_powers[position],
+                sizeof(double)*(state->pending_transmissions-position));
+        memmove(&state->pending_transmissions_ends[position+1],&state->pending_transmissions_ends[position],
+                sizeof(simtime_t)*(state->pending_transmissions-position));
+        memmove(&state->pending_transmissions_lost[position+1],&state->pending_transmissions_lost[position],
+                state->pending_transmissions-position);
+        memmove(&state->pending_transmissions_slots[position+1],&state->pending_transmissions_slots[position],
+                state->pending_transmissions-position);
+        state->pending_transmissions++;
 
         /*
-         * Set the next pointer to NULL: this will be the last pending transmission in the list
+         * Set the power of the transmission, the time when it finishes, the flag indicating whether the frame has been
+         * lost or not and the slot holding the frame
          */
 
-        new_transmission->next=NULL;
+        state->pending_transmissions_powers[position]=power;
+        state->pending_transmissions_ends[position]=end;
+        state->pending_transmissions_lost[position]=lost;
+        state->pending_transmissions_slots[position]=slot;
 
         /*
-         * Set the power of the transmission
+         * Return the index of the slot
          */
 
-        new_transmission->power=power;
+        return slot;
+}
+
+/*
+ * QUANTIZE GAIN
+ *
+ * Return the value of the given gain in hundredths of dB (see GAIN_RESOLUTION), rounded to the closest integer: the
+ * gains created by the LinkLayerModel have two decimal digits, so they are stored exactly.
+ * The simulation is aborted if the gain is out of the range of 16-bit integers
+ *
+ * @gain: the gain (in dBm)
+ */
+
+int16_t quantize_gain(double gain){
 
         /*
-         * Return the address
+         * The gain in hundredths of dB
          */
 
-        return new_transmission;
+        double quantized=nearbyint(gain*GAIN_RESOLUTION);
+
+        if(!(quantized>=INT16_MIN+1 && quantized<=INT16_MAX)){
+                printf("[FATAL ERROR] The gain %f of a link is out of the range that can be stored\n",gain);
+                exit(EXIT_FAILURE);
+        }
+        return (int16_t)quantized;
+}
+
+/*
+ * DEQUANTIZE GAIN
+ *
+ * Return the value in dBm of a gain in hundredths of dB
+ *
+ * @gain: the gain (in hundredths of dB)
+ */
+
+double dequantize_gain(int16_t gain){
+        return (double)gain/GAIN_RESOLUTION;
 }
 
 /*
  * ADD GAIN ENTRY
  *
- * Add a new element in the list associated to the given source node.
+ * Add a new element to the list of the links read from the input file.
  *
  * @source: ID of the source node of the link
  * @sink: ID of the sink node of the link
@@ -244,65 +589,61 @@ void add_gain_entry(unsigned int source, unsigned int sink, double gain){
         }
 
         /*
-         * Allocate the instance
+         * Check if the array is full: if so, double its size (the first time, allocate room for one link per node)
          */
 
-        entry=malloc(sizeof(gain_entry));
+        if(gain_entries_count==gain_entries_capacity){
 
-        /*
-         * Set the gain of the link
-         */
+                /*
+                 * Compute the new size of the array
+                 */
 
-        entry->gain=gain;
+                if(gain_entries_capacity)
+                        gain_entries_capacity*=2;
+                else
+                        gain_entries_capacity=n_prc_tot;
 
-        /*
-         * Set the sink node of the link
-         */
+                /*
+                 * Resize the array
+                 */
 
-        entry->sink=sink;
+                gain_entries=realloc(gain_entries,sizeof(gain_entry)*gain_entries_capacity);
+                if(!gain_entries){
+                        printf("[FATAL ERROR] Not enough memory to store the links of the network\n");
+                        fclose(file);
+                        exit(EXIT_FAILURE);
+                }
+        }
 
         /*
-         * Set the pointer to the next element to NULL
+         * Get the first free element of the array
          */
 
-        entry->next=NULL;
+        entry=&gain_entries[gain_entries_count];
 
         /*
-         * Check if this is the first element for the list of the source node
+         * Set the gain of the link
          */
 
-        if(!gains_list[source]){
+        entry->gain=quantize_gain(gain);
 
-                /*
-                 * It's the first element for the list of the source node => set the pointer in the array to this
-                 * instance
-                 */
-
-                gains_list[source]=entry;
-
-        }
-        else{
-
-                /*
-                 * Add the new entry after the last element of the list, starting from the first element
-                 */
+        /*
+         * Set the source node of the link
+         */
 
-                gain_entry* current=gains_list[source];
-                while(current->next){
+        entry->source=source;
 
-                        /*
-                         * Go to next element
-                         */
+        /*
+         * Set the sink node of the link
+         */
 
-                        current=current->next;
-                }
+        entry->sink=sink;
 
-                /*
-                 * Now current points to the last element of the list => connect it to the new entry
-                 */
+        /*
+         * Update the number of links read
+         */
 
-                current->next=entry;
-        }
+        gain_entries_count++;
 }
 
 /*
@@ -354,72 +695,6 @@ void add_noise_entry(unsigned int node, double noise_floor, double white_noise){
         entry->range=white_noise;
 }
 
-/*
- * COMPARE PENDING TRANSMISSIONS
- *
- * Given the pointers to two pending transmissions, this helper function compares their relevant fields and returns
- * true if they all coincide, false otherwise
- *
- * @a: pointer to a pending transmission
- * @b: pointer to the other pending transmission
- */
-
-bool compare_pending_transmissions(pending_transmission*a,pending_transmission*b){
-
-        /*
-         * Check if the metadata of the two transmissions coincide
-         */
-
-        if(a->frame_type==b->frame_type && a->lost==b->lost && a->power==b->power){
-
-                /*
-                 * Determine the type of frames brought by the transmissions
-                 */
-
-                if(a->frame_type==CTP_BEACON){
-
-                        /*
-                         * The frames are beacons
-                         */
-
-                        ctp_routing_packet* beacon_a=&a->frame.routing_packet;
-                        ctp_routing_packet* beacon_b=&b->frame.routing_packet;
-
-                        /*
-                         * Return true if the the beacons coincide
-                         */
-
-                        return compare_link_layer_frames(&beacon_a->link_frame,&beacon_b->link_frame) &&
-                               compare_link_estimator_frames(&beacon_a->link_estimator_frame,
-                                                             &beacon_b->link_estimator_frame) &&
-                               compare_beacons(&beacon_a->routing_frame,&beacon_b->routing_frame);
-                }
-                else{
-
-                        /*
-                         * The frames are data packets
-                         */
-
-                        ctp_data_packet* data_packet_a=&a->frame.data_packet;
-                        ctp_data_packet* data_packet_b=&b->frame.data_packet;
-
-                        /*
-                         * Return true if the data packets coincide
-                         */
-
-                        return compare_link_layer_frames(&data_packet_a->link_frame,&data_packet_b->link_frame) &&
-                               compare_data_packets(&data_packet_a->data_packet_frame,&data_packet_b->data_packet_frame,
-                                                    data_packet_a->payload,data_packet_b->payload);
-                }
-        }
-
-        /*
-         * The two objects refers to different transmissions because they have different metadata => return false
-         */
-
-        return false;
-}
-
 /*
  * SEND ACK
  *
@@ -450,31 +725,48 @@ void send_ack(node_state* state,ctp_data_packet* packet){
 /*
  * NEW PENDING TRANSMISSION
  *
- * Helper function for the event of type TRANSMISSION_STARTED
+ * Helper function for the events TRANSMISSION_BEACON_STARTED and TRANSMISSION_DATA_PACKET_STARTED
  * It is in charge of creating a new entry for the new pending transmission in the dedicated list of the node state;
  * also it has to check whether the transmission will be received by the node or not, depending on the actual strength
- * of the interferences created by other signals
+ * of the interferences created by other signals.
+ * The end of the transmission is handled when the node processes its first event after it (see
+ * "finish_pending_transmissions"): only if the node can receive the frame, it schedules an event TRANSMISSION_FINISHED
+ * to wake up at the end of the transmission and process the frame in time
  *
  * @state: pointer to the object representing the current state of the node
- * @gain: strength of the new transmission (in dBm)
+ * @reference: pointer to the reference to the frame in the broadcast buffer, with the gain of the link (in mW) and the
+ *             duration of the new transmission
+ * @size: number of bytes of the reference
  * @type: byte telling whether the frame contains a beacon or a data packet
- * @frame: pointer to the frame carried by the signal
- * @duration: duration of the new transmission
  */
 
-void new_pending_transmission(node_state* state, double gain,unsigned char type,void* frame,double duration){
+void new_pending_transmission(node_state* state,transmission_reference* reference,unsigned int size,
+                              unsigned char type){
 
         /*
-         * Pointer to the new instance of type "pending_transmission" created for the new transmission
+         * Strength of the new transmission (in mW)
          */
 
-        pending_transmission* new_pending_transmission=NULL;
+        double gain=reference->gain_mw;
 
         /*
-         * Pointer to the last element in the list of pending transmissions
+         * Copy of the frame carried by the signal and pointer to its link layer frame
          */
 
-        pending_transmission* last_transmission=NULL;
+        union transmission_frame frame;
+        link_layer_frame* link_frame=type==CTP_BEACON?&frame.routing_packet.link_frame:&frame.data_packet.link_frame;
+
+        /*
+         * Boolean value telling whether the frame is still in the broadcast buffer
+         */
+
+        bool frame_available;
+
+        /*
+         * Time when the new transmission finishes
+         */
+
+        simtime_t end=state->lvt+reference->duration;
 
         /*
          * Boolean value telling whether the new transmission has enough power to be received by the node
@@ -483,30 +775,61 @@ void new_pending_transmission(node_state* state, double gain,unsigned char type,
         bool lost_transmission=true;
 
         /*
-         * Counter of pending transmissions
+         * Copy the frame from the broadcast buffer: if it's not there anymore, the node can't receive it, but its signal
+         * is sensed anyway
          */
 
-        unsigned int pending_transmissions_count=0;
+        frame_available=fetch_broadcast_frame(reference,size,type,&frame);
+        if(!frame_available)
+                bzero(&frame,sizeof(union transmission_frame));
 
         /*
-         * Check if the node is running: if not, it will not receive the frame transmitted
+         * Fill the fields of the link layer frame that depend on the receiver
          */
 
-        if(state->state&RUNNING) {
+        link_frame->src=reference->sender;
+        link_frame->seq=reference->seq;
+        link_frame->gain_mw=gain;
+        link_frame->gain=mw_to_dbm(gain);
+        link_frame->duration=reference->duration;
 
-                /*
-                 * Then get the strength of the signal affecting the channel perceived by the node at
-                 * the moment
-                 */
-
-                double channel_strength=compute_signal_strength(state);
+        /*
+         * Check if all the slots of the pool of pending transmissions are used: if so, the node has no room for the
+         * frame, which is lost, but its signal is sensed anyway => it still hides the weaker pending transmissions and
+         * adds to the strength of the channel until it finishes, when it's removed by the event
+         * DROPPED_TRANSMISSION_FINISHED
+         */
+
+        if(state->free_pending_transmissions==NO_PENDING_TRANSMISSION){
+                mark_lost_transmissions(state,0,gain*reception_ratio);
+                state->pending_transmissions_power+=gain;
+                if(type==CTP_BEACON)
+                        node_statistics_list[state->me].lost_beacons+=1;
+                else
+                        node_statistics_list[state->me].lost_data_packets+=1;
+                ScheduleNewEvent(state->me,end,DROPPED_TRANSMISSION_FINISHED,&gain,sizeof(double));
+                return;
+        }
+
+        /*
+         * Check if the node is running and the frame is available: if not, it will not receive the frame transmitted
+         */
+
+        if(state->state&RUNNING && frame_available) {
+
+                /*
+                 * Then get the strength of the signal affecting the channel perceived by the node at
+                 * the moment
+                 */
+
+                double channel_strength=compute_signal_strength(state);
 
                 /*
                  * Check if the gain of the link is enough strong for the frame to be delivered, considering the
                  * actual strength of the signal sensed by the node: if not, the frame is dropped
                  */
 
-                if(channel_strength+csma_sensitivity<gain){
+                if(channel_strength*reception_ratio<gain){
 
                         /*
                          * The signal carrying the frame has enough power for the frame to be received
@@ -532,225 +855,120 @@ void new_pending_transmission(node_state* state, double gain,unsigned char type,
         }
 
         /*
-         * Go through the list of pending transmissions and check whether the current transmission will cause the node
-         * to miss some of them because they are too weak w.r.t to the new one
-         */
-
-        pending_transmission* current=state->pending_transmissions;
-        while(current!=NULL){
-
-                /*
-                 * If the difference between the power of the current transmission and the power of the new one is below
-                 * the threshold, the former is lost
-                 */
-
-                if(current->power-csma_sensitivity<gain)
-                        current->lost=true;
-
-                /*
-                 * Go to next element of the list and store the pointer to the last NOT NULL element
-                 */
-
-                last_transmission=current;
-                current=current->next;
-
-                /*
-                 * Update the counter of pending transmissions
-                 */
-
-                pending_transmissions_count++;
-        }
-
-        /*
-         * Increment the counter of the strength of the signal sensed by the node (convert from dBm to
-         * mW)
+         * Check whether the new transmission will cause the node to miss some of the pending ones because they are too
+         * weak w.r.t to the new one: this is the case if the difference between the power of a pending transmission
+         * and the power of the new one is below the threshold
          */
 
-        state->pending_transmissions_power+=pow(10.0, gain / 10.0);
+        mark_lost_transmissions(state,0,gain*reception_ratio);
 
         /*
-         * Create an entry for the the new pending transmission
+         * Increment the counter of the strength of the signal sensed by the node
          */
 
-        new_pending_transmission=create_pending_transmission(type,frame,gain,lost_transmission);
+        state->pending_transmissions_power+=gain;
 
         /*
-         * Check if there are other pending transmissions
+         * Create an entry for the the new pending transmission: it's placed among the other ones according to the time
+         * when it finishes
          */
 
-        if(pending_transmissions_count){
-
-                /*
-                 * There are other pending transmissions => add the new transmission at the end of the list and get
-                 * the address
-                 */
-
-                last_transmission->next=new_pending_transmission;
-
-        }
-        else{
-
-                /*
-                 * This is the only pending transmission => set the pointer of the list of pending transmission to its
-                 * address
-                 */
-
-                state->pending_transmissions=new_pending_transmission;
-        }
+        create_pending_transmission(state,type,&frame,gain,lost_transmission,end);
 
         /*
-         * Schedule a new event corresponding to the moment when the transmission will be finished
+         * If the node can receive the frame, schedule a new event corresponding to the moment when the transmission
+         * will be finished: the other transmissions are finished lazily
          */
 
-        if(state->me<n_prc_tot)
-                ScheduleNewEvent(state->me,state->lvt+duration,TRANSMISSION_FINISHED,new_pending_transmission,
-                                 sizeof(pending_transmission));
-        else{
-                printf("[FATAL ERROR] Scheduling event of type %d for node %d, that does not exist"
-                               "\n", TRANSMISSION_FINISHED,state->me);
-                exit(EXIT_FAILURE);
-        }
+        if(!lost_transmission)
+                wait_until(state->me,end,TRANSMISSION_FINISHED);
 }
 
 /*
  * TRANSMISSION FINISHED
  *
- * Helper function for the event TRANSMISSION_FINISHED
- * It is in charge of removing the element of the finished transmission from the list of pending transmissions: if the
- * transmission has been successfully received by the node, it starts processing the associated frame
+ * Helper function for "finish_pending_transmissions"
+ * It is in charge of removing the first transmission to finish from the in-flight ones: if the transmission has been
+ * successfully received by the node, it starts processing the associated frame
  *
  * @state: pointer to the object representing the current state of the node
- * @finished_transmission: pointer to the finished transmission
  */
 
-void transmission_finished(node_state* state,pending_transmission* finished_transmission){
+void transmission_finished(node_state* state){
 
         /*
-         * Pointer to the element of the list that points to the transmission that is now finished
+         * Index of the slot of the finished transmission: it's the first one of the in-flight transmissions
          */
 
-        pending_transmission* predecessor=NULL;
+        unsigned char finished_slot=state->pending_transmissions_slots[0];
 
         /*
-         * The address given as second parameter does not coincide with the address of the object representing the
-         * finished transmission in the list of the pending transmissions => we have to find it scanning the list.
-         * It is used to free memory allocated for the transmission
+         * Pointer to the finished transmission
          */
 
-        pending_transmission* finished_transmission_list=NULL;
+        pending_transmission* finished_transmission=&state->pending_transmissions_pool[finished_slot];
 
         /*
-         * Type of the content of the frame transmitted
+         * Strength of the signal of the finished transmission (in mW)
          */
 
-        unsigned char type;
+        double finished_power=state->pending_transmissions_powers[0];
 
         /*
-         * In time between the beginning and the end of this transmission, new frames may have been sent to the node and
-         * so there may be further pending transmissions whose power is not strong enough compared to the current
-         * transmission => they will be missed by the node
+         * Boolean value telling whether the finished transmission has been lost
          */
 
+        bool finished_lost=state->pending_transmissions_lost[0];
+
         /*
-         * Pointer to the current transmission being checked
+         * Pointer to the link layer frame of the finished transmission
          */
 
-        pending_transmission* current_transmission=state->pending_transmissions;
-        if(!state->pending_transmissions) {
-                /*printf("pending transmissions NULL\n");
-                fflush(stdout);*/
-        }
+        link_layer_frame* finished_link_frame=finished_transmission->frame_type==CTP_BEACON?
+                                              &finished_transmission->frame.routing_packet.link_frame:
+                                              &finished_transmission->frame.data_packet.link_frame;
 
         /*
-         * Go through all the pending transmissions
+         * Type of the content of the frame transmitted
          */
 
-        while(current_transmission!=NULL){
-
-                /*
-                 * Check if the transmission analyzed is predecessor of the transmission finisehed in the list of
-                 * pending transmissions
-                 */
-
-                if(current_transmission->next &&
-                   compare_pending_transmissions(current_transmission->next,finished_transmission)) {
-
-                        /*
-                         * Found the predecessor
-                         */
-
-                        predecessor=current_transmission;
-
-                        /*
-                         * Found the address of the pending transmission in the list
-                         */
-
-                        finished_transmission_list=current_transmission->next;
-                }
-
-                /*
-                 * Check if the transmission analyzed will be missed by the node because not enough strong w.r.t. the
-                 * transmission that is finishing
-                 */
-
-                if(!compare_pending_transmissions(current_transmission,finished_transmission)){
-                        if(current_transmission->power-csma_sensitivity<finished_transmission->power){
-                                current_transmission->lost=true;
-                        }
-                }
-
-                /*
-                 * Go to next element of the list
-                 */
-
-                current_transmission=current_transmission->next;
-        }
+        unsigned char type;
 
         /*
-         * Remove the finished transmission from the list
+         * In time between the beginning and the end of this transmission, new frames may have been sent to the node and
+         * so there may be further pending transmissions whose power is not strong enough compared to the current
+         * transmission => they will be missed by the node
          */
 
-        if(predecessor){
-
-                /*
-                 * The list has this structure at the moment:
-                 *
-                 * ...->x->y->z..
-                 *
-                 * where y is the element to be removed
-                 */
-
-                predecessor->next=predecessor->next->next;
-
-                /*
-                 * Now the list is like this:
-                 *
-                 * ...x->z..
-                 */
-        }
-        else{
+        mark_lost_transmissions(state,1,finished_power*reception_ratio);
 
-                /*
-                 * If it is the first element of the list, update the pointer to the list
-                 */
+        /*
+         * Remove the finished transmission from the head of the in-flight transmissions
+         */
 
-                finished_transmission_list=state->pending_transmissions;
-                state->pending_transmissions=state->pending_transmissions->next;
-        }
+        state->pending_transmissions--;
+        memmove(&state->pending_transmissions_powers[0],&state->pending_transmissions_powers[1],
+                sizeof(double)*state->pending_transmissions);
+        memmove(&state->pending_transmissions_ends[0],&state->pending_transmissions_ends[1],
+                sizeof(simtime_t)*state->pending_transmissions);
+        memmove(&state->pending_transmissions_lost[0],&state->pending_transmissions_lost[1],
+                state->pending_transmissions);
+        memmove(&state->pending_transmissions_slots[0],&state->pending_transmissions_slots[1],
+                state->pending_transmissions);
 
         /*
          * Remove the power associated to transmission from the strength of the global signal sensed by the node
          */
 
-        state->pending_transmissions_power-=pow(10.0, finished_transmission->power / 10.0);
+        state->pending_transmissions_power-=finished_power;
 
         /*
          * It may be the case that while the transmission was ongoing, even  stronger transmission have come and so this
-         * transmission will be missed by the node too
+         * transmission will be missed by the node too (see "is_frame_corrupted")
          */
 
-        if(finished_transmission->power-csma_sensitivity<compute_signal_strength(state)) {
-                finished_transmission->lost = true;
+        if(is_frame_corrupted(finished_transmission->frame_type,finished_power,compute_signal_strength(state))) {
+                finished_lost=true;
                 if(finished_transmission->frame_type==CTP_BEACON)
                         node_statistics_list[state->me].lost_beacons+=1;
                 else
@@ -761,7 +979,7 @@ void transmission_finished(node_state* state,pending_transmission* finished_tran
          * If the frame has been received by the node, it has to be processed
          */
 
-        if(!finished_transmission->lost){
+        if(!finished_lost){
 
                 /*
                  * The frame has been received => get its type
@@ -785,17 +1003,7 @@ void transmission_finished(node_state* state,pending_transmission* finished_tran
                          * First get the recipient, as indicated in the link layer frame
                          */
 
-                        /*
-                         * The frame contains a data packet => extract the link layer frame from the packet
-                         */
-
-                        link_layer_frame *link_frame = &finished_transmission->frame.data_packet.link_frame;
-
-                        /*
-                         * Get the intended recipient
-                         */
-
-                        unsigned int recipient = link_frame->sink;
+                        unsigned int recipient = finished_link_frame->sink;
 
                         /*
                          * If this is the recipient and is not busy transmitting, send an acknowledgment
@@ -820,299 +1028,1328 @@ void transmission_finished(node_state* state,pending_transmission* finished_tran
         state->radio_state&=~RADIO_RECEIVING;
 
         /*
-         * Finally remove the element associated to the pending transmission
+         * Finally give the slot of the pending transmission back to the pool
          */
 
-        free(finished_transmission_list);
+        finished_transmission->next=state->free_pending_transmissions;
+        state->free_pending_transmissions=finished_slot;
+}
+
+/*
+ * FINISH PENDING TRANSMISSIONS
+ *
+ * Handle the end of all the pending transmissions that have finished by the current time, in the order they finished:
+ * this is done at the beginning of every event processed by the node, so the list of pending transmissions is up to
+ * date whenever the node looks at it
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+void finish_pending_transmissions(node_state* state){
+        while(state->pending_transmissions && state->pending_transmissions_ends[0]<=state->lvt)
+                transmission_finished(state);
+}
+
+/*
+ * DROPPED TRANSMISSION FINISHED
+ *
+ * Handle the end of a transmission that the node sensed when all the slots of its pool of pending transmissions were
+ * used (see "new_pending_transmission"): its signal no longer exists, so its power is removed from the strength of the
+ * signal sensed by the node
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @power: power of the signal of the transmission (in mW)
+ */
+
+void dropped_transmission_finished(node_state* state,double power){
+        state->pending_transmissions_power-=power;
+}
+
+/*
+ * GET LOWEST NOISE
+ *
+ * Return the lowest value (in dBm) that the noise affecting the given node can take: it's the lowest sample of the
+ * trace, if the noise is taken from a trace, otherwise the lower bound of the range of the noise of the node
+ *
+ * @sink: ID of the node
+ */
+
+double get_lowest_noise(unsigned int sink){
+        if(trace_noise)
+                return get_lowest_trace_noise();
+        return noise_list[sink].noise_floor+white_noise_mean-noise_list[sink].range;
+}
+
+/*
+ * GET RECEPTION SINR
+ *
+ * Return the lowest SINR (in dB) at which a frame can still be received, according to the reception model (see
+ * RECEPTION_MODEL): with the threshold model it's "csma_sensitivity", with the PRR model it's the lowest SINR of the PRR
+ * table, so that the frames in the gray zone are not dropped when their reception starts or when a stronger signal
+ * comes, but only by the random draw when their transmission finishes (see "is_frame_corrupted")
+ */
+
+static double get_reception_sinr(){
+        return reception_model==RECEPTION_PRR?PRR_TABLE_MIN_SINR:csma_sensitivity;
 }
 
 /*
- * CHECK GAINS LIST
+ * GET AUDIBILITY CUTOFF
+ *
+ * Return the weakest gain (in dBm) that a link towards the given node can have for the signals travelling through it
+ * to make any difference to the node:
  *
- * This function checks that there's a list of gains for each node in the simulation and that such a list contains
- * exactly a number of elements equal to n_prc_tot-1: if this two conditions are not verified, the simulation is aborted
+ * 1-a frame can be received only if its strength is at least the reception SINR (see "get_reception_sinr") above the
+ *   signal sensed by the node, which is never below the lowest value of its noise
+ * 2-a frame being received is lost if another signal whose strength is not the reception SINR below it comes => a
+ *   signal can corrupt a frame only if it's stronger than the lowest value of the noise of the node
+ * 3-a signal whose strength is above "channel_free_threshold" makes the channel busy on its own
+ *
+ * The lowest of the three values above, decreased by "audibility_margin", is the cutoff: a weaker signal can only
+ * matter if it overlaps with many other weak signals, which the margin is meant to account for
+ *
+ * @sink: ID of the node
  */
 
-void check_gains_list(){
+double get_audibility_cutoff(unsigned int sink){
 
         /*
-         * Counter of elements in each list
+         * Get the lowest value of the noise affecting the node
          */
 
-        unsigned int counter=0;
+        double lowest_noise=get_lowest_noise(sink);
 
         /*
-         * Index of the node
+         * A frame is received or corrupted by signals having strength above the lowest noise (first two conditions)
          */
 
-        unsigned int index;
+        double reception_sinr=get_reception_sinr();
+        double cutoff=lowest_noise+(reception_sinr<0?reception_sinr:0);
 
         /*
-         * Check correctness of the list for each node
+         * A signal above the threshold makes the channel busy (third condition)
          */
 
-        for(index=0;index<n_prc_tot;index++){
+        if(channel_free_threshold<cutoff)
+                cutoff=channel_free_threshold;
 
-                /*
-                 * Check that there is a list of gains for node "index"
-                 */
+        /*
+         * Apply the margin
+         */
 
-                if(gains_list[index]) {
+        return cutoff-audibility_margin;
+}
 
-                        /*
-                         * The first element of the list
-                         */
+/*
+ * GET DELIVERY CUTOFF
+ *
+ * Return the weakest gain (in dBm) that a link towards the given node can have for the transmissions through it to be
+ * delivered to the node: if the topology is sparse, the links that are not audible are dropped (see
+ * "get_audibility_cutoff"); if the far field is aggregated, the links whose gain is below "far_field_threshold" are
+ * dropped as well, since their power is accounted for by the background power of the node.
+ * If neither applies, all the links are kept
+ *
+ * @sink: ID of the node
+ */
 
-                        gain_entry *current =gains_list[index];
+double get_delivery_cutoff(unsigned int sink){
 
-                        /*
-                         * Count the number of elements in the list
-                         */
+        /*
+         * The cutoff: no link is dropped by default
+         */
 
-                        while(current){
-                                counter++;
-                                current=current->next;
-                        }
+        double cutoff=-HUGE_VAL;
 
-                        /*
-                         * Check that the list contains n_prc_tot-1 elements: if not, return false
-                         */
+        if(sparse_topology)
+                cutoff=get_audibility_cutoff(sink);
+        if(far_field_aggregation && far_field_threshold>cutoff)
+                cutoff=far_field_threshold;
+        return cutoff;
+}
 
-                        if(counter!=n_prc_tot-1) {
-                                printf("[FATAL ERROR] Node %d has %d links; they have to be %d\n",index,counter,
-                                       n_prc_tot-1);
-                                exit(EXIT_FAILURE);
-                        }
+/*
+ * ALLOCATE FAR FIELD
+ *
+ * Allocate the array of the background power of the nodes, with all the values set to 0: they are filled when the
+ * links are dropped from the gain table (see "build_gain_table") or, if the gains are computed from the coordinates of
+ * the nodes, by each node for itself (see "init_node_noise")
+ */
 
-                        /*
-                         * The list of gains for the current node is correct = > resent the counter and go to the next
-                         * node
-                         */
+void allocate_far_field(){
+        far_field_mw=calloc(n_prc_tot,sizeof(double));
+        if(!far_field_mw){
+                printf("[FATAL ERROR] Not enough memory to store the background power of the nodes\n");
+                exit(EXIT_FAILURE);
+        }
+}
 
-                        counter=0;
-                        continue;
-                }
+/*
+ * GET PAIR INDEX
+ *
+ * Return the position of the gain of the given pair of nodes in the gains of the pairs: the pairs (i,j) with i<j are
+ * stored row by row, so the row of node i starts after the n-1+n-2+...+n-i pairs of the previous rows
+ *
+ * @first: ID of one of the nodes of the pair
+ * @second: ID of the other node of the pair (different from the first one)
+ */
 
-                /*
-                 * The list of gains of the links for the current node is missing => abort
-                 */
+unsigned long get_pair_index(unsigned int first,unsigned int second){
 
-                printf("[FATAL ERROR] No link specified for node %d; they have to be %d\n",index,n_prc_tot-1);
-                exit(EXIT_FAILURE);
-        }
+        /*
+         * The nodes of the pair, the lowest ID first
+         */
+
+        unsigned long low=first<second?first:second;
+        unsigned long high=first<second?second:first;
+
+        return low*(2*(unsigned long)n_prc_tot-low-1)/2+high-low-1;
 }
 
 /*
- * CHECK NOISE LIST
+ * BUILD PAIR TABLE
  *
- * This function checks that there's a value of noise floor and white gaussian noise for each node in the simulation and
- * if this condition is not verified, the simulation is aborted
+ * Store the gains of the links read from the input file for the pairs of nodes: the gain of the link from node i to
+ * node j has to be the same of the link from node j to node i, otherwise the simulation is aborted.
+ * No link is dropped from the table: the links whose transmissions are not delivered are skipped when a frame is sent
+ * (see "transmit_to_node"), but their gain is added to the background power of the sink node here, if the far field is
+ * aggregated. Unless the far field is aggregated, the gains of all the pairs have to be given (the gains of the pairs
+ * are not used with a sparse topology, see "parse_physical_layer_parameters")
  */
 
-void check_noises_list(){
+void build_pair_table(){
 
         /*
-         * Index of the node
+         * Index of the link and of the pair
          */
 
-        unsigned int index;
+        unsigned long index;
+        unsigned long pair;
 
         /*
-         * Check correctness of the value for each node
+         * Number of pairs
          */
 
-        for(index=0;index<n_prc_tot;index++){
+        unsigned long pairs=(unsigned long)n_prc_tot*(n_prc_tot-1)/2;
 
-                /*
-                 * Check that the noise entry for node "index" is initialized: if not, abort the simulation
-                 */
+        /*
+         * Allocate the gains of the pairs, all missing at first
+         */
 
-                if(!noise_list[index].noise_floor && !noise_list[index].range) {
-                        printf("[FATAL ERROR] Noise for node %d is not given\n", index);
+        gains_table.pair_gains=malloc(sizeof(int16_t)*(pairs?pairs:1));
+        if(!gains_table.pair_gains){
+                printf("[FATAL ERROR] Not enough memory to store the gains of the links\n");
+                exit(EXIT_FAILURE);
+        }
+        for(pair=0;pair<pairs;pair++)
+                gains_table.pair_gains[pair]=MISSING_GAIN;
+
+        /*
+         * Store the gain of each link, checking that it's the same of the opposite link
+         */
+
+        for(index=0;index<gain_entries_count;index++){
+                if(gain_entries[index].source==gain_entries[index].sink){
+                        printf("[FATAL ERROR] Node IDs of the link are not valid\n");
+                        exit(EXIT_FAILURE);
+                }
+                pair=get_pair_index(gain_entries[index].source,gain_entries[index].sink);
+                if(gains_table.pair_gains[pair]!=MISSING_GAIN && gains_table.pair_gains[pair]!=gain_entries[index].gain){
+                        printf("[FATAL ERROR] The gains of the links between nodes %u and %u are not symmetric\n",
+                               gain_entries[index].source,gain_entries[index].sink);
                         exit(EXIT_FAILURE);
                 }
+                gains_table.pair_gains[pair]=gain_entries[index].gain;
+                if(far_field_aggregation &&
+                   dequantize_gain(gain_entries[index].gain)<get_delivery_cutoff(gain_entries[index].sink))
+                        far_field_mw[gain_entries[index].sink]+=dbm_to_mw(dequantize_gain(gain_entries[index].gain))*
+                                                               far_field_activity;
+        }
+
+        /*
+         * Check that the gains of all the pairs are given, unless the far field is aggregated
+         */
+
+        if(!far_field_aggregation){
+                for(pair=0;pair<pairs;pair++){
+                        if(gains_table.pair_gains[pair]==MISSING_GAIN){
+                                printf("[FATAL ERROR] The gains of the links are not given for all the pairs of "
+                                               "nodes\n");
+                                exit(EXIT_FAILURE);
+                        }
+                }
         }
 
+        /*
+         * Release the links read from the input file
+         */
+
+        free(gain_entries);
+        gain_entries=NULL;
+        gain_entries_count=0;
+        gain_entries_capacity=0;
 }
 
 /*
- * TRANSMIT FRAME
- *
- * This function simulates the physical transmission of a link-layer frame to another node through a wireless link.
- * The wireless channel is shared by all the nodes of the network, so the signals carrying the frames will interfere
- * one another => a signal travelling through a link is received by the sink node only if its strength is greater than
- * the strength of the noise resulting from the sum of all the other signals plus the noise affecting the sink node
- * itself. Moreover, if a signal B is sent to same sink node as another signal A, with A weaker than B, the sink node
- * will only receive the signal B => we have to keep track of all the signals being transmitted to each node: if two or
- * more signals overlaps in time, only the strongest one will be received by the node. That's why this function only
- * informs the recipient node that the transmission of a frame has started at time x and will finish at some time in the
- * future y, when the frame will be delivered => the recipient node has to keep track of the ongoing transmissions that
- * occur in the interval between x and y because they may overwrite the former transmission
+ * BUILD GAIN TABLE
  *
- * @state: pointer to the object representing the current state of the node
- * @type: byte telling whether the frame contains a beacon or a data packet
+ * Move the links read from the input file to the gain table, grouping them by source node; the links of each node keep
+ * the same order they have in the input file.
+ * When the topology is sparse, the links whose gain is below the audibility cutoff of their sink node (see
+ * "get_audibility_cutoff") are not moved to the table: frames are then only sent to the nodes that can be affected by
+ * them, so the number of events generated by a transmission is proportional to the number of audible neighbors rather
+ * than to the size of the network.
+ * The noise of all the nodes has to be known when this function is invoked
  */
 
-void transmit_frame(node_state* state,unsigned char type){
+void build_gain_table(){
 
         /*
-         * Get the first element in the list of the links of the sender
+         * Index of the link
          */
 
-        gain_entry* gain_entry=gains_list[state->me];
+        unsigned long index;
 
         /*
-         * Transmit the frame to all the nodes connected to the sender: the description of each link is an element of
-         * the list.
+         * If the gains are symmetric, store them for the pairs of nodes rather than for the links
          */
 
-        while(gain_entry){
+        if(symmetric_gains){
+                build_pair_table();
+                return;
+        }
 
-                /*
-                 * Get the gain of the link
-                 */
+        /*
+         * Index of the node
+         */
 
-                double gain=gain_entry->gain;
+        unsigned int node;
 
-                /*
-                 * Get the sink node of the link
-                 */
+        /*
+         * Number of links kept in the table
+         */
 
-                unsigned int sink=gain_entry->sink;
+        unsigned int links=0;
 
-                /*
-                 * Set the value of the gain in the link-layer header of the frame: this is required by the simulation
-                 * to determine whether the packet will be received by the recipient node or not.
-                 * First parse the frame being transmitted to the data structure corresponding to the type
-                 */
+        /*
+         * Position of the next link of each node in the table: the array is reused to count the links of each node
+         */
 
-                if(type==CTP_BEACON){
+        unsigned int* next_position;
 
-                        /*
-                         * This frame contains a beacon
-                         */
+        /*
+         * Allocate the array of the offsets and the auxiliary array of positions; the latter is initialized to zero
+         */
 
-                        state->routing_packet.link_frame.gain=gain;
+        gains_table.offsets=malloc(sizeof(unsigned int)*(n_prc_tot+1));
+        next_position=calloc(n_prc_tot,sizeof(unsigned int));
 
-                        /*
-                         * Schedule a new event destined to the sink node of the link, containing the frame being
-                         * transmitted
-                         */
+        /*
+         * Flag the links whose transmissions are not delivered, replacing their source with an invalid ID, and count
+         * the number of remaining links of each node: if the far field is aggregated, the gains of the flagged links
+         * are added to the background power of their sink node
+         */
 
-                        if(sink<n_prc_tot)
-                                ScheduleNewEvent(sink,state->lvt,TRANSMISSION_BEACON_STARTED,&state->routing_packet,
-                                                 sizeof(ctp_routing_packet));
-                        else{
-                                printf("[FATAL ERROR] Scheduling event of type %d for node %d, that does not exist"
-                                               "\n",TRANSMISSION_BEACON_STARTED,sink);
-                                exit(EXIT_FAILURE);
-                        }
+        for(index=0;index<gain_entries_count;index++){
+                if(dequantize_gain(gain_entries[index].gain)<get_delivery_cutoff(gain_entries[index].sink)) {
+                        if(far_field_aggregation)
+                                far_field_mw[gain_entries[index].sink]+=
+                                        dbm_to_mw(dequantize_gain(gain_entries[index].gain))*far_field_activity;
+                        gain_entries[index].source=UINT_MAX;
+                        continue;
+                }
+                next_position[gain_entries[index].source]++;
+        }
+
+        /*
+         * Compute the offset of each node as the sum of the links of the previous nodes and set the position of its
+         * first link accordingly
+         */
+
+        for(node=0;node<n_prc_tot;node++){
+                gains_table.offsets[node]=links;
+                links+=next_position[node];
+                next_position[node]=gains_table.offsets[node];
+        }
+        gains_table.offsets[n_prc_tot]=links;
+
+        /*
+         * Allocate the arrays of the sink nodes and gains
+         */
+
+        gains_table.sinks=malloc(sizeof(unsigned int)*(links?links:1));
+        gains_table.gains=malloc(sizeof(int16_t)*(links?links:1));
+
+        /*
+         * Copy each link (that has not been dropped) in the next position of its source node
+         */
+
+        for(index=0;index<gain_entries_count;index++){
+                if(gain_entries[index].source==UINT_MAX)
+                        continue;
+                gains_table.sinks[next_position[gain_entries[index].source]]=gain_entries[index].sink;
+                gains_table.gains[next_position[gain_entries[index].source]]=gain_entries[index].gain;
+                next_position[gain_entries[index].source]++;
+        }
+
+        /*
+         * Release the auxiliary array and the links read from the input file
+         */
+
+        free(next_position);
+        free(gain_entries);
+        gain_entries=NULL;
+        gain_entries_count=0;
+        gain_entries_capacity=0;
+}
+
+/*
+ * CHECK GAIN ROW
+ *
+ * This function checks that the gain table contains some links for the given node, that their number is exactly
+ * n_prc_tot-1 and that their sink nodes are valid: if these conditions are not verified, the simulation is aborted.
+ * If the topology is sparse, a node may have any number of links up to n_prc_tot-1, including none.
+ * Each node checks its own links when it is initialized, so the check is split among all the logical processes
+ *
+ * @node: ID of the node
+ */
+
+void check_gain_row(unsigned int node){
+
+        /*
+         * Number of links of the node
+         */
+
+        unsigned int counter;
+
+        /*
+         * Index of the link
+         */
+
+        unsigned int link;
+
+        /*
+         * If the gains are computed from the coordinates of the nodes, there's no link to check; if they are stored for
+         * the pairs of nodes, they have already been checked (see "build_pair_table")
+         */
+
+        if(procedural_channel || gains_table.pair_gains)
+                return;
+        counter=gains_table.offsets[node+1]-gains_table.offsets[node];
+
+        /*
+         * Check that there is at least a link for the node, unless the topology is sparse or the far field is
+         * aggregated: if not, abort
+         */
+
+        if(!counter && !sparse_topology && !far_field_aggregation){
+                printf("[FATAL ERROR] No link specified for node %d; they have to be %d\n",node,n_prc_tot-1);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the node has n_prc_tot-1 links (at most n_prc_tot-1 links if the topology is sparse or the far
+         * field is aggregated): if not, abort
+         */
+
+        if(counter>n_prc_tot-1 || (!sparse_topology && !far_field_aggregation && counter!=n_prc_tot-1)) {
+                printf("[FATAL ERROR] Node %d has %d links; they have to be %d\n",node,counter,n_prc_tot-1);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Check that the sink of each link is a valid node
+         */
+
+        for(link=gains_table.offsets[node];link<gains_table.offsets[node+1];link++){
+                if(gains_table.sinks[link]>=n_prc_tot){
+                        printf("[FATAL ERROR] Node IDs of the link are not valid\n");
+                        exit(EXIT_FAILURE);
+                }
+        }
+}
+
+/*
+ * CONVERT PHYSICAL LAYER PARAMETERS
+ *
+ * Convert the thresholds of the physical layer and of the link layer from dBm to linear units: this has to be done once
+ * all the parameters of the simulation have been parsed
+ */
+
+void convert_physical_layer_parameters(){
+
+        /*
+         * The channel is free if the power sensed is below the threshold
+         */
+
+        channel_free_threshold_mw=dbm_to_mw(channel_free_threshold);
+
+        /*
+         * A signal can be received only if it is stronger than the interferences by the reception SINR, i.e. if its
+         * power is at least this ratio times the power of the interferences
+         */
+
+        reception_ratio=dbm_to_mw(get_reception_sinr());
+
+        /*
+         * If frames are received according to the packet reception ratio, precompute it
+         */
+
+        if(reception_model==RECEPTION_PRR)
+                build_prr_table();
+}
+
+/*
+ * GET BIT ERROR RATE
+ *
+ * Return the bit error rate of the CC2420 radio (O-QPSK modulation with DSSS, IEEE 802.15.4 at 2.4 GHz) for the given
+ * SINR:
+ *
+ * BER=8/15*1/16*sum_{k=2}^{16}((-1)^k*binomial(16,k)*exp(20*SINR*(1/k-1)))
+ *
+ * The value is kept in the range [0,0.5], since the sum loses precision when the SINR is very low
+ *
+ * @sinr: the SINR, in linear units
+ */
+
+static double get_bit_error_rate(double sinr){
+
+        /*
+         * Sum of the series, binomial coefficient of the current term and index of the term
+         */
+
+        double sum=0;
+        double binomial=120;
+        unsigned int k;
+
+        for(k=2;k<=16;k++){
+                sum+=(k%2?-binomial:binomial)*exp(20*sinr*(1.0/k-1));
+                binomial=binomial*(16-k)/(k+1);
+        }
+        sum*=8.0/15/16;
+
+        if(sum<0)
+                return 0;
+        if(sum>0.5)
+                return 0.5;
+        return sum;
+}
+
+/*
+ * BUILD PRR TABLE
+ *
+ * Compute the packet reception ratio of the CC2420 radio for each SINR of the table: a frame of L bytes is received if
+ * none of its bits is wrong, which happens with probability (1-BER)^(8*L). The length of a frame only depends on its
+ * content (CTP_BEACON_LENGTH or CTP_DATA_PACKET_LENGTH bytes), so there is a row for each type of frame.
+ * This is done only once, so that a reception only costs a lookup in the table and a random draw
+ */
+
+void build_prr_table(){
+
+        /*
+         * Index of the SINR in the table and bit error rate for that SINR
+         */
+
+        unsigned int index;
+        double ber;
+
+        for(index=0;index<PRR_TABLE_SIZE;index++){
+                ber=get_bit_error_rate(dbm_to_mw(PRR_TABLE_MIN_SINR+index*PRR_TABLE_STEP));
+                prr_table[0][index]=pow(1-ber,8*CTP_BEACON_LENGTH);
+                prr_table[1][index]=pow(1-ber,8*CTP_DATA_PACKET_LENGTH);
+        }
+}
+
+/*
+ * IS FRAME CORRUPTED
+ *
+ * Decide whether a frame whose transmission has just finished is lost because of the rest of the signal sensed by the
+ * node, according to the reception model (see RECEPTION_MODEL):
+ *
+ * 1-with the threshold model, the frame is lost if its strength is not at least "csma_sensitivity" above the signal
+ * 2-with the PRR model, the SINR of the frame (in dB) is rounded to the closest value of the table and the frame is
+ *   received with the corresponding probability
+ *
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ * @power: strength of the signal of the transmission (in mW)
+ * @signal_strength: strength of the signal sensed by the node, not including the transmission (in mW)
+ */
+
+bool is_frame_corrupted(unsigned char type,double power,double signal_strength){
+
+        /*
+         * Position of the SINR of the frame in the table
+         */
+
+        double position;
+
+        if(reception_model==RECEPTION_THRESHOLD)
+                return power<signal_strength*reception_ratio;
+
+        /*
+         * Get the position of the SINR in the table: out of the range, the frame is either always lost or always
+         * received
+         */
+
+        position=(mw_to_dbm(power/signal_strength)-PRR_TABLE_MIN_SINR)/PRR_TABLE_STEP+0.5;
+        if(position<0)
+                return true;
+        if(position>=PRR_TABLE_SIZE)
+                return false;
+        return Random()>=prr_table[type==CTP_BEACON?0:1][(unsigned int)position];
+}
+
+/*
+ * ALLOCATE NOISE FLOORS
+ *
+ * Allocate the array of the noise floors in mW: their values are filled later by each node (see "init_node_noise")
+ */
+
+void allocate_noise_floors(){
+        noise_floor_mw=malloc(sizeof(double)*n_prc_tot);
+        if(!noise_floor_mw){
+                printf("[FATAL ERROR] Not enough memory to store the noise of the nodes\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * AGGREGATE FAR CELLS
+ *
+ * Add to the background power of the given node the power of the nodes in the cells of the spatial grid that are not
+ * around the cell of the node: their transmissions are never delivered to the node (see "build_spatial_grid"), so each
+ * cell is taken as a whole, as if all its nodes were at its center, with the mean power of the links of that length,
+ * i.e. the power at the median times the mean value of the shadowing (see "compute_mean_shadowing_gain").
+ * The cost is proportional to the number of cells rather than to the number of nodes
+ *
+ * @node: ID of the node
+ * @near_cells: cells around the cell of the node (see "get_neighbour_cells")
+ * @near_cells_count: number of cells around the cell of the node
+ */
+
+static void aggregate_far_cells(unsigned int node,const unsigned int* near_cells,unsigned int near_cells_count){
+
+        /*
+         * Number of cells of the grid, index of the current one and of the current cell around the node
+         */
+
+        unsigned int cells=grid.columns*grid.rows;
+        unsigned int cell;
+        unsigned int near_cell;
+
+        /*
+         * Number of far cells holding some node, their number of nodes and the gain of the links from their centers
+         */
+
+        unsigned int far_cells=0;
+        unsigned int* far_nodes=malloc(sizeof(unsigned int)*cells);
+        double* far_gains=malloc(sizeof(double)*cells);
+        if(!far_nodes || !far_gains){
+                printf("[FATAL ERROR] Not enough memory to compute the background power of node %d\n",node);
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Compute the gain of the link from the center of each far cell holding some node
+         */
+
+        for(cell=0;cell<cells;cell++){
+                if(grid.offsets[cell]==grid.offsets[cell+1])
+                        continue;
+                for(near_cell=0;near_cell<near_cells_count && near_cells[near_cell]!=cell;near_cell++);
+                if(near_cell<near_cells_count)
+                        continue;
+                far_nodes[far_cells]=grid.offsets[cell+1]-grid.offsets[cell];
+                far_gains[far_cells]=compute_path_gain(get_cell_distance(node,cell));
+                far_cells++;
+        }
+
+        /*
+         * Convert all the gains to mW at once and add the mean power of the nodes of each far cell
+         */
+
+        dbm_to_mw_array(far_gains,far_gains,far_cells);
+        for(cell=0;cell<far_cells;cell++)
+                far_field_mw[node]+=far_nodes[cell]*far_gains[cell]*mean_shadowing_gain*far_field_activity;
+
+        free(far_nodes);
+        free(far_gains);
+}
+
+/*
+ * INIT NODE NOISE
+ *
+ * Convert the noise floor of the given node from dBm to mW: the power of the signals sensed by a node is then summed
+ * and compared without any further conversion while the simulation runs. If the gains are computed from the coordinates
+ * of the nodes and the far field is aggregated, also compute the background power of the node
+ *
+ * @node: ID of the node
+ */
+
+void init_node_noise(unsigned int node){
+
+        /*
+         * ID of the source node of a link towards the node and gain of the link
+         */
+
+        unsigned int source;
+        double gain;
+
+        /*
+         * Cells of the spatial grid around the node, their number and the index of the current one, and index of the
+         * current node of the cell
+         */
+
+        unsigned int cells[9];
+        unsigned int cells_count;
+        unsigned int cell;
+        unsigned int position;
+
+        /*
+         * Convert the static component of the noise, including the mean value of the dynamic component
+         */
+
+        noise_floor_mw[node]=dbm_to_mw(noise_list[node].noise_floor+white_noise_mean);
+
+        /*
+         * If the gains are computed from the coordinates of the nodes and the far field is aggregated, sum the gains of
+         * the links towards the node whose transmissions are not delivered to it (the shadowing of a link is the same
+         * in both the directions, so the gain of each link is computed as if the node were the source)
+         */
+
+        if(!procedural_channel || !far_field_aggregation)
+                return;
+
+        /*
+         * If the spatial grid is not used, any node may be close to this one => compute the gain of each link
+         */
+
+        if(!grid_enabled){
+                for(source=0;source<n_prc_tot;source++){
+                        if(source==node)
+                                continue;
+                        gain=compute_link_gain(node,source);
+                        if(gain<get_delivery_cutoff(node))
+                                far_field_mw[node]+=dbm_to_mw(gain)*far_field_activity;
+                }
+                return;
+        }
+
+        /*
+         * Otherwise compute the gain of each link only for the nodes in the cells around the node, which may or may not
+         * be delivered to it, and aggregate the other cells
+         */
+
+        cells_count=get_neighbour_cells(node,cells);
+        for(cell=0;cell<cells_count;cell++){
+                for(position=grid.offsets[cells[cell]];position<grid.offsets[cells[cell]+1];position++){
+                        source=grid.nodes[position];
+                        if(source==node)
+                                continue;
+                        gain=compute_link_gain(node,source);
+                        if(gain<get_delivery_cutoff(node))
+                                far_field_mw[node]+=dbm_to_mw(gain)*far_field_activity;
+                }
+        }
+        aggregate_far_cells(node,cells,cells_count);
+}
+
+/*
+ * CHECK NOISE LIST
+ *
+ * This function checks that there's a value of noise floor and white gaussian noise for each node in the simulation and
+ * if this condition is not verified, the simulation is aborted
+ */
+
+void check_noises_list(){
+
+        /*
+         * Index of the node
+         */
+
+        unsigned int index;
+
+        /*
+         * Check correctness of the value for each node
+         */
+
+        for(index=0;index<n_prc_tot;index++){
+
+                /*
+                 * Check that the noise entry for node "index" is initialized: if not, abort the simulation
+                 */
+
+                if(!noise_list[index].noise_floor && !noise_list[index].range) {
+                        printf("[FATAL ERROR] Noise for node %d is not given\n", index);
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+}
+
+/*
+ * TRANSMIT TO NODE
+ *
+ * Send the reference to a frame being transmitted to the given node, when the gain of the link is not taken from the
+ * rows of the gain table: it's either computed from the coordinates of the nodes (see "channel_model.c") or taken from
+ * the gains of the pairs of nodes. If the gain of the link is below the cutoff of the node (see "get_delivery_cutoff"),
+ * the node is skipped, as done by "build_gain_table". With LPL, the node is also skipped if its radio is sleeping while
+ * the frame is sent (see "get_reception_start")
+ *
+ * @state: pointer to the object representing the current state of the sender
+ * @sink: ID of the recipient node
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ * @reference: reference to the frame, whose gain is set by this function
+ * @reference_size: number of bytes of the reference that are sent
+ */
+
+static void transmit_to_node(node_state* state,unsigned int sink,unsigned char type,transmission_reference* reference,
+                             unsigned int reference_size){
+
+        /*
+         * Gain of the link towards the node, in dBm
+         */
+
+        double gain;
+
+        /*
+         * Gain of the pair of nodes, in hundredths of dB
+         */
+
+        int16_t pair_gain;
+
+        /*
+         * Time when the node starts sensing the frame
+         */
+
+        simtime_t reception;
+
+        if(!get_reception_start(sink,type,state->lvt,reference->duration,&reception))
+                return;
+        if(procedural_channel)
+                get_link_gain(state->me,sink,&gain,&reference->gain_mw);
+        else{
+                pair_gain=gains_table.pair_gains[get_pair_index(state->me,sink)];
+                if(pair_gain==MISSING_GAIN)
+                        return;
+                gain=dequantize_gain(pair_gain);
+                reference->gain_mw=dbm_to_mw(gain);
+        }
+        if(gain<get_delivery_cutoff(sink))
+                return;
+        ScheduleNewEvent(sink,reception,type==CTP_BEACON?TRANSMISSION_BEACON_STARTED:TRANSMISSION_DATA_PACKET_STARTED,
+                         reference,reference_size);
+}
+
+/*
+ * TRANSMIT FRAME
+ *
+ * This function simulates the physical transmission of a link-layer frame to another node through a wireless link.
+ * The wireless channel is shared by all the nodes of the network, so the signals carrying the frames will interfere
+ * one another => a signal travelling through a link is received by the sink node only if its strength is greater than
+ * the strength of the noise resulting from the sum of all the other signals plus the noise affecting the sink node
+ * itself. Moreover, if a signal B is sent to same sink node as another signal A, with A weaker than B, the sink node
+ * will only receive the signal B => we have to keep track of all the signals being transmitted to each node: if two or
+ * more signals overlaps in time, only the strongest one will be received by the node. That's why this function only
+ * informs the recipient node that the transmission of a frame has started at time x and will finish at some time in the
+ * future y, when the frame will be delivered => the recipient node has to keep track of the ongoing transmissions that
+ * occur in the interval between x and y because they may overwrite the former transmission.
+ * The frame is stored only once in the broadcast buffer: the recipient nodes just receive a reference to it
+ *
+ * @state: pointer to the object representing the current state of the node
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ */
+
+void transmit_frame(node_state* state,unsigned char type){
+
+        /*
+         * Index of the link in the gain table
+         */
 
-                }
-                else{
+        unsigned int link;
 
-                        /*
-                         * This frame contains a data packet
-                         */
+        /*
+         * ID of the recipient node
+         */
+
+        unsigned int sink;
+
+        /*
+         * Time when the recipient node starts sensing the frame
+         */
+
+        simtime_t reception;
+
+        /*
+         * Pointer to the frame being transmitted and to its link layer frame
+         */
+
+        void* frame;
+        link_layer_frame* link_frame;
+
+        /*
+         * Reference to the frame in the broadcast buffer, sent to the nodes connected to the sender, and the number of
+         * bytes of the reference that are sent
+         */
+
+        transmission_reference reference;
+        unsigned int reference_size=TRANSMISSION_REFERENCE_SIZE;
+
+        /*
+         * Get the frame being transmitted: it's either the beacon of the node or the data packet at the head of the
+         * forwarding queue
+         */
+
+        if(type==CTP_BEACON){
+                frame=&state->routing_packet;
+                link_frame=&state->routing_packet.link_frame;
+        }
+        else{
+                frame=&state->forwarding_queue[state->forwarding_queue_head]->packet;
+                link_frame=&state->forwarding_queue[state->forwarding_queue_head]->packet.link_frame;
+        }
+
+        /*
+         * Tag the transmission with the next sequence number of the node: together with the ID of the node, this is the
+         * unique ID of the transmission
+         */
+
+        link_frame->seq=state->transmission_sequence_number;
+        state->transmission_sequence_number++;
 
-                        state->data_packet.link_frame.gain=gain;
+        /*
+         * Store the frame in the broadcast buffer, once for all the nodes connected to the sender: if there's no room
+         * for it, copy it in the reference
+         */
+
+        if(!store_broadcast_frame(state->me,type,frame,link_frame->seq)){
+                if(type==CTP_BEACON)
+                        reference.frame.routing_packet=*(ctp_routing_packet*)frame;
+                else
+                        reference.frame.data_packet=*(ctp_data_packet*)frame;
+                reference_size=sizeof(transmission_reference);
+        }
+
+        /*
+         * Fill the fields of the reference that are the same for all the nodes connected to the sender
+         */
+
+        reference.sender=state->me;
+        reference.seq=link_frame->seq;
+        reference.duration=link_frame->duration;
+
+        /*
+         * If the gains are computed from the coordinates of the nodes, transmit the frame to the other nodes, computing
+         * the gain of each link (or taking it from the cache of the sender): if the spatial grid is used, only the
+         * nodes in the cells around the sender and within the audible radius are considered, otherwise all of them
+         */
+
+        if(procedural_channel){
+                if(grid_enabled){
 
                         /*
-                         * Schedule a new event destined to the sink node of the link, containing the frame being
-                         * transmitted
+                         * Cells around the sender, their number and the index of the current one
                          */
 
-                        if(sink<n_prc_tot)
-                                ScheduleNewEvent(sink,state->lvt,TRANSMISSION_DATA_PACKET_STARTED,
-                                                 &state->forwarding_queue[state->forwarding_queue_head]->packet,
-                                                 sizeof(ctp_data_packet));
-                        else{
-                                printf("[FATAL ERROR] Scheduling event of type %d for node %d, that does not exist"
-                                               "\n", TRANSMISSION_DATA_PACKET_STARTED,sink);
-                                exit(EXIT_FAILURE);
+                        unsigned int cells[9];
+                        unsigned int cells_count=get_neighbour_cells(state->me,cells);
+                        unsigned int cell;
+
+                        for(cell=0;cell<cells_count;cell++){
+                                for(link=grid.offsets[cells[cell]];link<grid.offsets[cells[cell]+1];link++){
+                                        sink=grid.nodes[link];
+                                        if(sink!=state->me && is_within_audible_radius(state->me,sink))
+                                                transmit_to_node(state,sink,type,&reference,reference_size);
+                                }
+                        }
+                }
+                else{
+                        for(sink=0;sink<n_prc_tot;sink++){
+                                if(sink!=state->me)
+                                        transmit_to_node(state,sink,type,&reference,reference_size);
                         }
                 }
+                return;
+        }
+
+        /*
+         * If the gains are symmetric, transmit the frame to all the other nodes, taking the gain from the gains of the
+         * pairs of nodes
+         */
+
+        if(gains_table.pair_gains){
+                for(sink=0;sink<n_prc_tot;sink++){
+                        if(sink!=state->me)
+                                transmit_to_node(state,sink,type,&reference,reference_size);
+                }
+                return;
+        }
+
+        /*
+         * Transmit the frame to all the nodes connected to the sender: its links are stored contiguously in the gain
+         * table
+         */
+
+        for(link=gains_table.offsets[state->me];link<gains_table.offsets[state->me+1];link++){
+
+                /*
+                 * Get the sink node of the link
+                 */
+
+                sink=gains_table.sinks[link];
+
+                /*
+                 * With LPL, a node whose radio is sleeping doesn't sense the frame: no event is scheduled for it
+                 */
+
+                if(!get_reception_start(sink,type,state->lvt,reference.duration,&reception))
+                        continue;
+
+                /*
+                 * Set the value of the gain of the link in the reference: this is required by the simulation to
+                 * determine whether the packet will be received by the recipient node or not
+                 */
+
+                reference.gain_mw=dbm_to_mw(dequantize_gain(gains_table.gains[link]));
 
                 /*
-                 * Go to next entry
+                 * Schedule a new event destined to the sink node of the link, containing the reference to the frame
+                 * being transmitted
                  */
 
-                gain_entry=gain_entry->next;
+                if(sink<n_prc_tot)
+                        ScheduleNewEvent(sink,reception,type==CTP_BEACON?TRANSMISSION_BEACON_STARTED:
+                                                         TRANSMISSION_DATA_PACKET_STARTED,&reference,reference_size);
+                else{
+                        printf("[FATAL ERROR] Scheduling event of type %d for node %d, that does not exist"
+                                       "\n",type==CTP_BEACON?TRANSMISSION_BEACON_STARTED:TRANSMISSION_DATA_PACKET_STARTED,
+                               sink);
+                        exit(EXIT_FAILURE);
+                }
         }
 }
 
 /*
- * GET CURRENT NOISE
+ * IS AUDIBLE
  *
- * This function simulates the variability of the noise affecting a node by returning a random value from the uniform
- * distribution [white_noise_mean-noise_range,white_noise_mean+noise_range] and adding to the value pf the noise floor
+ * Return true if the frames transmitted by the source node can affect the sink node, i.e. if the gain of the link is
+ * not below the audibility cutoff of the sink (see "get_audibility_cutoff"), when the gain is not taken from the rows
+ * of the gain table
+ *
+ * @source: ID of the source node
+ * @sink: ID of the sink node
+ */
+
+static bool is_audible(unsigned int source,unsigned int sink){
+
+        /*
+         * Gain of the pair of nodes, in hundredths of dB
+         */
+
+        int16_t pair_gain;
+
+        if(procedural_channel)
+                return compute_link_gain(source,sink)>=get_audibility_cutoff(sink);
+        pair_gain=gains_table.pair_gains[get_pair_index(source,sink)];
+        return pair_gain!=MISSING_GAIN && dequantize_gain(pair_gain)>=get_audibility_cutoff(sink);
+}
+
+/*
+ * GET AUDIBLE NODES
+ *
+ * Fill the given array with the IDs of the nodes that can be affected by the frames transmitted by the given node and
+ * return their number: the nodes are looked for as in "transmit_frame", but the audibility cutoff of the nodes is used
+ * instead of the delivery one, so the result doesn't depend on which links are dropped. The array must have room for
+ * all the nodes
+ *
+ * @source: ID of the node
+ * @sinks: array where the IDs are stored
  */
 
-double get_current_noise(unsigned int node){
+unsigned int get_audible_nodes(unsigned int source,unsigned int* sinks){
 
         /*
-         * Get the mean value of the dynamic component of the noise
+         * Number of audible nodes found so far
          */
 
-        double mean=white_noise_mean;
+        unsigned int count=0;
 
         /*
-         * Get a random value to be added to the mean value of the dynamic component of the noise
+         * ID of the current node and index of the current link
          */
 
-        double rand=RandomRange(0,2000000);
-        rand/=1000000.0;
-        rand-=1.0;
-        rand*=noise_list[node].range;
+        unsigned int sink;
+        unsigned int link;
 
         /*
-         * Return the sum of the mean value of the of the dynamic component of the noise plus the random value from the
-         * uniform distribution
+         * If the gains are taken from the gain table, check the links of the node
          */
 
-        return mean+rand+noise_list[node].noise_floor;
+        if(!procedural_channel && !gains_table.pair_gains){
+                for(link=gains_table.offsets[source];link<gains_table.offsets[source+1];link++){
+                        sink=gains_table.sinks[link];
+                        if(dequantize_gain(gains_table.gains[link])>=get_audibility_cutoff(sink))
+                                sinks[count++]=sink;
+                }
+                return count;
+        }
+
+        /*
+         * If the spatial grid is used, only the nodes in the cells around the node are checked
+         */
+
+        if(procedural_channel && grid_enabled){
+
+                /*
+                 * Cells around the node, their number and the index of the current one
+                 */
+
+                unsigned int cells[9];
+                unsigned int cells_count=get_neighbour_cells(source,cells);
+                unsigned int cell;
+
+                for(cell=0;cell<cells_count;cell++){
+                        for(link=grid.offsets[cells[cell]];link<grid.offsets[cells[cell]+1];link++){
+                                sink=grid.nodes[link];
+                                if(sink!=source && is_audible(source,sink))
+                                        sinks[count++]=sink;
+                        }
+                }
+                return count;
+        }
+
+        /*
+         * Otherwise check all the other nodes
+         */
+
+        for(sink=0;sink<n_prc_tot;sink++){
+                if(sink!=source && is_audible(source,sink))
+                        sinks[count++]=sink;
+        }
+        return count;
 }
 
+/*
+ * ALLOCATE BROADCAST BUFFER
+ *
+ * Allocate the broadcast buffer, with all the slots empty, and the array of the committed transmissions of each node
+ */
+
+void allocate_broadcast_buffer(){
+
+        /*
+         * Index of the slot
+         */
+
+        unsigned long slot;
+
+        broadcast_buffer=malloc(sizeof(broadcast_frame)*n_prc_tot*BROADCAST_BUFFER_DEPTH);
+        committed_transmissions=malloc(sizeof(unsigned int)*n_prc_tot);
+        if(!broadcast_buffer || !committed_transmissions){
+                printf("[FATAL ERROR] Not enough memory to store the frames transmitted\n");
+                exit(EXIT_FAILURE);
+        }
+        bzero(committed_transmissions,sizeof(unsigned int)*n_prc_tot);
+        for(slot=0;slot<(unsigned long)n_prc_tot*BROADCAST_BUFFER_DEPTH;slot++)
+                broadcast_buffer[slot].seq=UINT_MAX;
+}
 
 /*
- * COMPUTE STRENGTH OF THE SIGNAL SENSED BY THE NODE
+ * COMMIT TRANSMISSIONS
  *
- * This function returns the power of the signal affecting the channel calculated by a node: it's the sum of the power
- * of the noise from the environment plus the power of the signals associated to all the packets that are being sent
- * to the node when the calculation is done.
+ * Record the number of transmissions performed by the node as of the GVT: this is called by "OnGVT" with the committed
+ * state of the node
  *
- * @state: pointer to the object representing the current state of the node
+ * @node: ID of the node
+ * @state: pointer to the committed state of the node
  */
 
-double compute_signal_strength(node_state* state){
+void commit_transmissions(unsigned int node,node_state* state){
+        __atomic_store_n(&committed_transmissions[node],state->transmission_sequence_number,__ATOMIC_RELAXED);
+}
+
+/*
+ * STORE BROADCAST FRAME
+ *
+ * Store a frame transmitted by the node in its slot of the broadcast buffer.
+ * The slot can be reused only if the frame it holds can no longer be read, i.e. if there's a later transmission of
+ * the same node that has been committed: since a node transmits one frame at a time, the events reading the old frame
+ * have a time below the GVT as well. If the slot holds a frame with a sequence number not lower than the new one, it
+ * was written by an execution that has been rolled back and it can be overwritten.
+ *
+ * @sender: ID of the node
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ * @frame: pointer to the frame
+ * @seq: sequence number of the transmission
+ *
+ * Returns true if the frame has been stored, false if the slot can't be reused yet
+ */
+
+bool store_broadcast_frame(unsigned int sender,unsigned char type,void* frame,unsigned int seq){
+
+        /*
+         * Pointer to the slot of the frame
+         */
+
+        broadcast_frame* slot=&broadcast_buffer[(unsigned long)sender*BROADCAST_BUFFER_DEPTH+seq%BROADCAST_BUFFER_DEPTH];
+
+        /*
+         * Sequence number of the frame currently in the slot
+         */
+
+        unsigned int old_seq=slot->seq;
+
+        /*
+         * Check that the slot can be reused
+         */
+
+        if(old_seq<seq && old_seq+1>=__atomic_load_n(&committed_transmissions[sender],__ATOMIC_RELAXED))
+                return false;
+
+        /*
+         * Mark the slot as being written, so that a node reading it at the same time (as part of an execution that is
+         * going to be rolled back) doesn't take it for a valid frame
+         */
+
+        __atomic_store_n(&slot->seq,UINT_MAX,__ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        /*
+         * Copy the frame
+         */
+
+        if(type==CTP_BEACON)
+                slot->frame.routing_packet=*(ctp_routing_packet*)frame;
+        else
+                slot->frame.data_packet=*(ctp_data_packet*)frame;
+
+        /*
+         * The slot now holds the frame
+         */
+
+        __atomic_store_n(&slot->seq,seq,__ATOMIC_RELEASE);
+        return true;
+}
+
+/*
+ * FETCH BROADCAST FRAME
+ *
+ * Copy a frame from the broadcast buffer, or from the reference itself if it carries the frame
+ *
+ * @reference: pointer to the reference to the frame
+ * @size: number of bytes of the reference
+ * @type: byte telling whether the frame contains a beacon or a data packet
+ * @frame: pointer to the variable where the frame is copied
+ *
+ * Returns true if the frame has been copied, false if the slot holds a different frame (this may only happen during an
+ * execution that is going to be rolled back)
+ */
+
+bool fetch_broadcast_frame(transmission_reference* reference,unsigned int size,unsigned char type,
+                           union transmission_frame* frame){
+
+        /*
+         * Pointer to the slot of the frame
+         */
+
+        broadcast_frame* slot=&broadcast_buffer[(unsigned long)reference->sender*BROADCAST_BUFFER_DEPTH+
+                                                reference->seq%BROADCAST_BUFFER_DEPTH];
+
+        /*
+         * If the reference carries the frame, copy it from there
+         */
+
+        if(size==sizeof(transmission_reference)){
+                *frame=reference->frame;
+                return true;
+        }
+
+        /*
+         * Check that the slot holds the frame
+         */
+
+        if(__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE)!=reference->seq)
+                return false;
+
+        /*
+         * Copy the frame
+         */
+
+        if(type==CTP_BEACON)
+                frame->routing_packet=slot->frame.routing_packet;
+        else
+                frame->data_packet=slot->frame.data_packet;
+
+        /*
+         * Check that the slot has not been written in the meantime
+         */
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&slot->seq,__ATOMIC_RELAXED)==reference->seq;
+}
+
+/*
+ * GET CURRENT NOISE
+ *
+ * This function simulates the variability of the noise affecting a node by returning a random value from the uniform
+ * distribution [white_noise_mean-noise_range,white_noise_mean+noise_range] and adding to the value pf the noise floor.
+ * The value is returned in mW: the static component (noise floor plus mean value of the dynamic component) is already
+ * converted, so only the random deviation from it has to be converted
+ */
+
+double get_current_noise(node_state* state){
+
+        /*
+         * Random value to be added to the mean value of the dynamic component of the noise
+         */
+
+        double rand;
 
         /*
-         * Get the current value of the noise affecting the node
+         * If the noise is taken from a trace, get the next sample of the node
          */
 
-        double noise=get_current_noise(state->me);
+        if(trace_noise)
+                return sample_noise(state);
 
         /*
-         * Transform the value above from dBm to mW (milli Watt)
-         * This is necessary to perform the sum of the power associated to signals as an algebraic sum
-         *
-         * 1mW=10^(1dbm/10)
+         * Get a random value to be added to the mean value of the dynamic component of the noise
          */
 
-        double strength=pow(10.0,noise/10.0);
+        rand=RandomRange(0,2000000);
+        rand/=1000000.0;
+        rand-=1.0;
+        rand*=noise_list[state->me].range;
 
         /*
-         * Add the sum of the power of all the transmissions sensed by the node (this value is in mW)
+         * Return the noise floor multiplied by the random deviation in linear units (adding dBm corresponds to
+         * multiplying mW)
          */
 
-        strength+=state->pending_transmissions_power;
+        return noise_floor_mw[state->me]*dbm_to_mw(rand);
+}
+
+
+/*
+ * COMPUTE STRENGTH OF THE SIGNAL SENSED BY THE NODE
+ *
+ * This function returns the power of the signal affecting the channel calculated by a node: it's the sum of the power
+ * of the noise from the environment plus the power of the signals associated to all the packets that are being sent
+ * to the node when the calculation is done.
+ * The power is in mW: all the strengths of signals are summed and compared in linear units
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+double compute_signal_strength(node_state* state){
 
         /*
-         * Transforms the value back to dBm because all the other parameters related to the strength of signals are
-         * given in dBm
+         * Return the sum of the current value of the noise affecting the node and the power of all the transmissions
+         * sensed by the node, including the background power of the transmissions that are not delivered to it
          */
 
-        return 10.0*log(strength)/log(10.0);
+        if(far_field_aggregation)
+                return get_current_noise(state)+state->pending_transmissions_power+far_field_mw[state->me];
+        return get_current_noise(state)+state->pending_transmissions_power;
 }
 
 /*
@@ -1140,7 +2377,65 @@ bool is_channel_free(node_state* state){
          * Return true if the strength is less than the threshold, false otherwise
          */
 
-        if(signal_strength<channel_free_threshold)
+        if(signal_strength<channel_free_threshold_mw)
                 return true;
         return false;
+}
+
+/*
+ * GET CHANNEL BUSY UNTIL
+ *
+ * Return the time until which the channel is certainly busy for the given node, according to the transmissions it is
+ * sensing now: the current time if the channel may be free right now.
+ * New transmissions can only add power to the channel and the noise never goes below its lowest value, so the channel
+ * stays busy as long as the transmissions still in flight, plus the lowest noise, are above the threshold. Since the
+ * transmissions are sorted by end time, the power still in flight at the end of each of them is the sum of the power
+ * of the following ones => scan them backwards, until this sum reaches the threshold
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+simtime_t get_channel_busy_until(node_state* state){
+
+        /*
+         * Position of the current transmission
+         */
+
+        unsigned int position=state->pending_transmissions;
+
+        /*
+         * Lowest strength of the signal sensed by the node while the transmissions from the current one on are in
+         * flight (in mW)
+         */
+
+        double strength;
+
+        /*
+         * If no transmission is sensed, the channel is busy only if the noise is above the threshold, which is checked
+         * at each sample
+         */
+
+        if(!position)
+                return state->lvt;
+
+        /*
+         * Start from the lowest noise, plus the background power of the transmissions that are not delivered to the
+         * node
+         */
+
+        strength=dbm_to_mw(get_lowest_noise(state->me));
+        if(far_field_aggregation)
+                strength+=far_field_mw[state->me];
+
+        /*
+         * Add the power of the transmissions, starting from the last one to finish: as soon as the threshold is
+         * reached, the channel is busy until the current transmission finishes
+         */
+
+        while(position--){
+                strength+=state->pending_transmissions_powers[position];
+                if(strength>=channel_free_threshold_mw)
+                        return state->pending_transmissions_ends[position];
+        }
+        return state->lvt;
 }
\ No newline at end of file
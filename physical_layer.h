@@ -21,16 +21,133 @@
 #define CHANNEL_FREE_THRESHOLD -95
 #endif
 
+/*
+ * If different from 0, the topology is treated as a sparse graph of audible links: the links whose gain is too weak to
+ * ever be received by the sink node, to make the channel of the sink node busy or to corrupt another frame are dropped
+ * after the input file is read, and the input file itself is allowed to list less than n-1 links for each node
+ */
+
+#ifndef SPARSE_TOPOLOGY
+#define SPARSE_TOPOLOGY 0
+#endif
+
+/*
+ * Safety margin (in dBm) applied below the cutoff of the audible links when the topology is sparse: a link is kept if
+ * its gain is above the cutoff minus this value, so that weak signals still contribute to the interferences when many
+ * of them overlap
+ */
+
+#ifndef AUDIBILITY_MARGIN
+#define AUDIBILITY_MARGIN 10
+#endif
+
+/*
+ * If different from 0, the transmissions through links whose gain is below FAR_FIELD_THRESHOLD (in dBm) are not
+ * delivered to the sink node: their power is replaced by a constant background power, i.e. the sum of the gains of
+ * such links, each multiplied by FAR_FIELD_ACTIVITY (the fraction of time a node is expected to be transmitting).
+ * The default threshold is close to the noise floor generated by LinkLayerModel.java, so the links that are dropped can
+ * hardly deliver a frame on their own
+ */
+
+/*
+ * If different from 0, the gain of the link from node i to node j has to be the same of the link from node j to node i:
+ * a single gain is stored for both the links, halving the memory taken by the gains
+ */
+
+#ifndef SYMMETRIC_GAINS
+#define SYMMETRIC_GAINS 0
+#endif
+
+/*
+ * Model deciding whether a frame is received when its transmission finishes (see "is_frame_corrupted"):
+ *
+ * RECEPTION_THRESHOLD-> the frame is received only if its strength is at least "csma_sensitivity" above the rest of the
+ * signal sensed by the node
+ * RECEPTION_PRR-> the frame is received with the probability given by the packet reception ratio (PRR) of the CC2420
+ * radio for the signal-to-interference-plus-noise ratio (SINR) of the frame and its length
+ *
+ * With the PRR model, a frame is only dropped before its transmission finishes (when its reception starts or when a
+ * stronger signal comes) if its SINR is below PRR_TABLE_MIN_SINR, rather than "csma_sensitivity"
+ */
+
+enum{
+        RECEPTION_THRESHOLD=0,
+        RECEPTION_PRR=1
+};
+
+#ifndef RECEPTION_MODEL
+#define RECEPTION_MODEL RECEPTION_THRESHOLD
+#endif
+
+/*
+ * The packet reception ratio is precomputed for PRR_TABLE_SIZE values of the SINR, spaced by PRR_TABLE_STEP dB
+ * starting from PRR_TABLE_MIN_SINR dB: below the range no frame is received, above it every frame is
+ */
+
+#ifndef PRR_TABLE_MIN_SINR
+#define PRR_TABLE_MIN_SINR -10.0
+#endif
+
+#ifndef PRR_TABLE_STEP
+#define PRR_TABLE_STEP 0.05
+#endif
+
+#ifndef PRR_TABLE_SIZE
+#define PRR_TABLE_SIZE 601
+#endif
+
+/*
+ * Value of a quantized gain telling that the gain of a pair of nodes is not given (see "quantize_gain")
+ */
+
+#define MISSING_GAIN INT16_MIN
+
+#ifndef FAR_FIELD_AGGREGATION
+#define FAR_FIELD_AGGREGATION 0
+#endif
+
+#ifndef FAR_FIELD_THRESHOLD
+#define FAR_FIELD_THRESHOLD -105
+#endif
+
+#ifndef FAR_FIELD_ACTIVITY
+#define FAR_FIELD_ACTIVITY 0.05
+#endif
+
 
 void init_physical_layer(node_state* state);
 void parse_physical_layer_parameters(void* event_content);
-pending_transmission* create_pending_transmission(unsigned char type,void* frame, double power,bool lost);
+unsigned char create_pending_transmission(node_state* state,unsigned char type,void* frame, double power,bool lost,
+                                          simtime_t end);
+int16_t quantize_gain(double gain);
+double dequantize_gain(int16_t gain);
 void add_gain_entry(unsigned int source, unsigned int sink, double gain);
 void add_noise_entry(unsigned int node, double noise_floor, double white_noise);
-void check_gains_list();
+unsigned long get_pair_index(unsigned int first,unsigned int second);
+void build_pair_table();
+void build_gain_table();
+void check_gain_row(unsigned int node);
+void allocate_noise_floors();
+void init_node_noise(unsigned int node);
+void convert_physical_layer_parameters();
+void build_prr_table();
+bool is_frame_corrupted(unsigned char type,double power,double signal_strength);
 void check_noises_list();
+double get_lowest_noise(unsigned int sink);
+double get_audibility_cutoff(unsigned int sink);
+double get_delivery_cutoff(unsigned int sink);
+void allocate_far_field();
 double compute_signal_strength(node_state* state);
 bool is_channel_free(node_state* state);
+simtime_t get_channel_busy_until(node_state* state);
 void transmit_frame(node_state* state,unsigned char type);
-void transmission_finished(node_state* state,pending_transmission* finished_transmission);
+unsigned int get_audible_nodes(unsigned int source,unsigned int* sinks);
+void allocate_broadcast_buffer();
+void commit_transmissions(unsigned int node,node_state* state);
+bool store_broadcast_frame(unsigned int sender,unsigned char type,void* frame,unsigned int seq);
+bool fetch_broadcast_frame(transmission_reference* reference,unsigned int size,unsigned char type,
+                           union transmission_frame* frame);
+void transmission_finished(node_state* state);
+void finish_pending_transmissions(node_state* state);
+void dropped_transmission_finished(node_state* state,double power);
 #endif //SENSORSNETWORKMODELPROJECT_PHYSICAL_LAYER_H
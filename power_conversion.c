@@ -0,0 +1,291 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "power_conversion.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * POWER CONVERSION
+ *
+ * The conversion from dBm to mW computes 10^(x/10)=2^y, where y=x*log2(10)/10: y is split into the closest integer n and
+ * the remainder f, in the range [-0.5,0.5] => 2^y=2^n*2^f, where 2^n is built directly setting the exponent bits of a
+ * double and 2^f is approximated by a polynomial.
+ * The conversion from mW to dBm computes 10*log10(x)=10*log10(2)*log2(x): x is split into its binary exponent e and its
+ * mantissa m, normalized to the range [sqrt(2)/2,sqrt(2)) => log2(x)=e+log2(m), where log(m) is approximated by a series
+ * that converges quickly in that range
+ */
+
+/*
+ * Factor converting a value in dBm to the corresponding power of 2 of the value in mW: log2(10)/10
+ */
+
+#define DBM_TO_LOG2 0.33219280948873623
+
+/*
+ * Factor converting the natural logarithm of a value in mW to the value in dBm: 10/ln(10)
+ */
+
+#define LN_TO_DBM 4.3429448190325183
+
+/*
+ * Natural logarithm of 2
+ */
+
+#define LN2 0.69314718055994531
+
+/*
+ * Coefficients of the polynomial approximating 2^f in the range [-0.5,0.5]: the i-th coefficient is ln(2)^i/i!, so the
+ * polynomial is the Taylor series of 2^f truncated to the 8th term (relative error below 3e-9)
+ */
+
+#define EXP2_C1 0.69314718055994531
+#define EXP2_C2 0.24022650695910071
+#define EXP2_C3 0.055504108664821580
+#define EXP2_C4 0.0096181291076284772
+#define EXP2_C5 0.0013333558146428443
+#define EXP2_C6 0.00015403530393381609
+#define EXP2_C7 0.000015252733804059841
+
+/*
+ * BUILD POWER OF 2
+ *
+ * Return 2^n, setting the exponent bits of a double
+ *
+ * @n: the exponent, in the range of the normal doubles
+ */
+
+static inline double power_of_two(int n){
+
+        /*
+         * The bits of the double: the exponent is biased by 1023 and it starts at bit 52
+         */
+
+        uint64_t bits=(uint64_t)(n+1023)<<52;
+
+        /*
+         * The double corresponding to the bits
+         */
+
+        double result;
+
+        memcpy(&result,&bits,sizeof(double));
+        return result;
+}
+
+/*
+ * DBM TO MW
+ *
+ * Convert a power from dBm to mW
+ *
+ * @dbm: the power in dBm
+ *
+ * Returns the power in mW
+ */
+
+double dbm_to_mw(double dbm){
+
+        /*
+         * The exponent of 2 corresponding to the value, its closest integer and the remainder
+         */
+
+        double y;
+        double n;
+        double f;
+
+        /*
+         * Clamp the value to the range that can be converted
+         */
+
+        if(dbm<MIN_CONVERTIBLE_DBM)
+                dbm=MIN_CONVERTIBLE_DBM;
+        if(dbm>MAX_CONVERTIBLE_DBM)
+                dbm=MAX_CONVERTIBLE_DBM;
+
+        /*
+         * Split the exponent into its closest integer and the remainder
+         */
+
+        y=dbm*DBM_TO_LOG2;
+        n=nearbyint(y);
+        f=y-n;
+
+        /*
+         * Return 2^n*2^f, with 2^f given by the polynomial (Horner's method)
+         */
+
+        return power_of_two((int)n)*(1.0+f*(EXP2_C1+f*(EXP2_C2+f*(EXP2_C3+f*(EXP2_C4+f*(EXP2_C5+f*(EXP2_C6+
+                                                                                                 f*EXP2_C7)))))));
+}
+
+/*
+ * MW TO DBM
+ *
+ * Convert a power from mW to dBm
+ *
+ * @mw: the power in mW
+ *
+ * Returns the power in dBm (minus infinity if the power is not positive)
+ */
+
+double mw_to_dbm(double mw){
+
+        /*
+         * The bits of the value
+         */
+
+        uint64_t bits;
+
+        /*
+         * The binary exponent of the value
+         */
+
+        int exponent;
+
+        /*
+         * The mantissa of the value, the variable of the series and its square
+         */
+
+        double mantissa;
+        double s;
+        double s2;
+
+        /*
+         * A power that is not positive (or not a number) has no corresponding value in dBm
+         */
+
+        if(!(mw>0))
+                return -HUGE_VAL;
+
+        /*
+         * Infinity stays the same
+         */
+
+        if(isinf(mw))
+                return mw;
+
+        /*
+         * Subnormal values have no exponent bits => scale them first
+         */
+
+        if(mw<2.2250738585072014e-308)
+                return mw_to_dbm(mw*4503599627370496.0)-52*LN2*LN_TO_DBM;
+
+        /*
+         * Split the value into the exponent and the mantissa in the range [1,2)
+         */
+
+        memcpy(&bits,&mw,sizeof(double));
+        exponent=(int)((bits>>52)&0x7ff)-1023;
+        bits=(bits&0x000fffffffffffffULL)|0x3ff0000000000000ULL;
+        memcpy(&mantissa,&bits,sizeof(double));
+
+        /*
+         * Move the mantissa to the range [sqrt(2)/2,sqrt(2))
+         */
+
+        if(mantissa>=1.4142135623730951){
+                mantissa*=0.5;
+                exponent++;
+        }
+
+        /*
+         * ln(m)=2*(s+s^3/3+s^5/5+...), where s=(m-1)/(m+1) is at most 0.172 in absolute value
+         */
+
+        s=(mantissa-1.0)/(mantissa+1.0);
+        s2=s*s;
+
+        /*
+         * Return 10*log10(x)=(ln(2)*e+ln(m))*10/ln(10)
+         */
+
+        return (exponent*LN2+2.0*s*(1.0+s2*(1.0/3+s2*(1.0/5+s2*(1.0/7+s2*(1.0/9+s2*(1.0/11)))))))*LN_TO_DBM;
+}
+
+/*
+ * DBM TO MW (ARRAY)
+ *
+ * Convert an array of powers from dBm to mW: the result is the same of "dbm_to_mw" applied to each element, but if the
+ * processor supports the SSE2 instructions two elements are converted at the same time
+ *
+ * @dbm: the powers in dBm
+ * @mw: array where the powers in mW are stored (it can coincide with the first one)
+ * @count: number of elements of the arrays
+ */
+
+void dbm_to_mw_array(const double* dbm,double* mw,unsigned int count){
+
+        /*
+         * Index of the element
+         */
+
+        unsigned int index=0;
+
+#ifdef __SSE2__
+
+        /*
+         * Constants of the conversion, for both the elements converted at the same time
+         */
+
+        const __m128d min_dbm=_mm_set1_pd(MIN_CONVERTIBLE_DBM);
+        const __m128d max_dbm=_mm_set1_pd(MAX_CONVERTIBLE_DBM);
+        const __m128d dbm_to_log2=_mm_set1_pd(DBM_TO_LOG2);
+        const __m128d one=_mm_set1_pd(1.0);
+        const __m128i bias=_mm_set1_epi32(1023);
+
+        /*
+         * Convert two elements at a time, with the same steps of "dbm_to_mw"
+         */
+
+        for(;index+2<=count;index+=2){
+
+                /*
+                 * Clamp the values and compute the exponents of 2
+                 */
+
+                __m128d y=_mm_mul_pd(_mm_min_pd(_mm_max_pd(_mm_loadu_pd(&dbm[index]),min_dbm),max_dbm),dbm_to_log2);
+
+                /*
+                 * Closest integers (as 32-bit integers in the two lowest lanes) and remainders
+                 */
+
+                __m128i n=_mm_cvtpd_epi32(y);
+                __m128d f=_mm_sub_pd(y,_mm_cvtepi32_pd(n));
+
+                /*
+                 * Polynomial approximating 2^f
+                 */
+
+                __m128d p=_mm_set1_pd(EXP2_C7);
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C6));
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C5));
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C4));
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C3));
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C2));
+                p=_mm_add_pd(_mm_mul_pd(p,f),_mm_set1_pd(EXP2_C1));
+                p=_mm_add_pd(_mm_mul_pd(p,f),one);
+
+                /*
+                 * Build 2^n: bias the exponents, move them to the two 64-bit lanes and shift them to bit 52
+                 */
+
+                __m128i exponents=_mm_slli_epi64(_mm_unpacklo_epi32(_mm_add_epi32(n,bias),_mm_setzero_si128()),52);
+
+                /*
+                 * Store 2^n*2^f
+                 */
+
+                _mm_storeu_pd(&mw[index],_mm_mul_pd(p,_mm_castsi128_pd(exponents)));
+        }
+
+#endif
+
+        /*
+         * Convert the remaining elements one at a time
+         */
+
+        for(;index<count;index++)
+                mw[index]=dbm_to_mw(dbm[index]);
+}
@@ -0,0 +1,30 @@
+#ifndef SENSORSNETWORKMODELPROJECT_POWER_CONVERSION_H
+#define SENSORSNETWORKMODELPROJECT_POWER_CONVERSION_H
+
+/*
+ * POWER CONVERSION
+ *
+ * Conversion of the strength of signals between the logarithmic scale (dBm) and the linear one (mW), without the
+ * functions "pow" and "log" of the math library: the relative error of a conversion is below 1e-8, i.e. the error is
+ * below 1e-7 dB, far less than the resolution of the gains of the input file (0.01 dB).
+ * The conversion from dBm to mW is also available for whole arrays at once (e.g. the gains of the links of a node): if
+ * the processor supports the SSE2 instructions, more values are converted at the same time.
+ */
+
+/*
+ * Lowest and highest values (in dBm) that can be converted: values out of this range are clamped to it
+ */
+
+#ifndef MIN_CONVERTIBLE_DBM
+#define MIN_CONVERTIBLE_DBM -3000.0
+#endif
+
+#ifndef MAX_CONVERTIBLE_DBM
+#define MAX_CONVERTIBLE_DBM 3000.0
+#endif
+
+double dbm_to_mw(double dbm);
+double mw_to_dbm(double mw);
+void dbm_to_mw_array(const double* dbm,double* mw,unsigned int count);
+
+#endif //SENSORSNETWORKMODELPROJECT_POWER_CONVERSION_H
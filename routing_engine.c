@@ -19,6 +19,7 @@
  * I_bmax.
  */
 
+#include <limits.h>
 #include <ROOT-Sim.h>
 #include "application.h"
 
@@ -27,6 +28,7 @@
  * Default values of the parameters for the routing engine (check routing_engine.h for a description)
  */
 
+unsigned int routing_table_size=ROUTING_TABLE_SIZE;
 double update_route_timer=UPDATE_ROUTE_TIMER;
 unsigned int max_one_hop_etx=MAX_ONE_HOP_ETX;
 unsigned int parent_switch_threshold=PARENT_SWITCH_THRESHOLD;
@@ -43,6 +45,8 @@ extern node_statistics* node_statistics_list;
 
 void parse_routing_engine_parameters(void* event_content){
 
+        if(IsParameterPresent(event_content, "routing_table_size"))
+                routing_table_size=(unsigned int)GetParameterInt(event_content,"routing_table_size");
         if(IsParameterPresent(event_content, "update_route_timer"))
                 update_route_timer=GetParameterDouble(event_content,"update_route_timer");
         if(IsParameterPresent(event_content, "max_one_hop_etx"))
@@ -53,6 +57,15 @@ void parse_routing_engine_parameters(void* event_content){
                 min_beacons_send_interval=GetParameterDouble(event_content,"min_beacons_send_interval");
         if(IsParameterPresent(event_content, "max_beacons_send_interval"))
                 max_beacons_send_interval=GetParameterDouble(event_content,"max_beacons_send_interval");
+
+        /*
+         * The size of the routing table has to fit the indexes used to scan it
+         */
+
+        if(!routing_table_size || routing_table_size>UCHAR_MAX){
+                printf("[FATAL ERROR] The size of the routing table has to be between 1 and %d\n",UCHAR_MAX);
+                exit(EXIT_FAILURE);
+        }
 }
 
 
@@ -70,6 +83,7 @@ void init_route_info(node_state* state) {
                 state->route.parent= INVALID_ADDRESS;
         state->route.etx = 0;
         state->route.congested=false;
+        state->parent_entry=NOT_A_CANDIDATE;
 }
 
 /*
@@ -92,10 +106,11 @@ void start_routing_engine(node_state* state){
         state->current_interval=min_beacons_send_interval;
 
         /*
-         * Set the number of valid entries in the ROUTING TABLE to 0
+         * Set the number of valid entries in the ROUTING TABLE and of candidate parents to 0
          */
 
         state->neighbors=0;
+        state->parent_candidates_count=0;
 
         /*
          * Set the initial number of parent changes to 0
@@ -178,6 +193,264 @@ unsigned char find_index_routing_table(unsigned int address,routing_table_entry*
         return index;
 }
 
+/*
+ * CANDIDATE PARENTS - start
+ *
+ * The entries of the routing table whose neighbor can be selected as parent (i.e. it has a route, it's not a child of
+ * the node, it's not congested and the quality of the link to it is good enough) are kept in a binary heap, ordered by
+ * the ETX of the route through them and, in case of ties, by their position in the table: the first candidate is the
+ * one "update_route" would choose by scanning the whole table. The heap is updated only when an entry of the table or
+ * the 1-hop ETX of a neighbor changes, so the route is updated without scanning the table
+ */
+
+/*
+ * GET CANDIDATE ETX
+ *
+ * Returns the ETX of the route through the neighbor of the given entry of the routing table
+ *
+ * @entry: pointer to the entry of the routing table
+ */
+
+static unsigned short get_candidate_etx(routing_table_entry* entry){
+        return (unsigned short)(entry->one_hop_etx+entry->info.etx);
+}
+
+/*
+ * IS BETTER CANDIDATE
+ *
+ * Returns true if the route through the neighbor at the first given position of the routing table is better than the
+ * one through the neighbor at the second given position
+ *
+ * @first: index of the first entry of the routing table
+ * @second: index of the second entry of the routing table
+ * @routing_table: pointer to the routing table of the node
+ */
+
+static bool is_better_candidate(unsigned char first,unsigned char second,routing_table_entry* routing_table){
+
+        /*
+         * ETX of the routes through the two neighbors
+         */
+
+        unsigned short first_etx=get_candidate_etx(&routing_table[first]);
+        unsigned short second_etx=get_candidate_etx(&routing_table[second]);
+
+        /*
+         * In case of ties, the entry that comes first in the table is the better one
+         */
+
+        return first_etx<second_etx || (first_etx==second_etx && first<second);
+}
+
+/*
+ * PLACE CANDIDATE
+ *
+ * Store the given entry of the routing table at the given position of the heap of the candidate parents
+ *
+ * @position: position in the heap
+ * @index: index of the entry in the routing table
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static void place_candidate(unsigned char position,unsigned char index,node_state* state){
+        state->parent_candidates[position]=index;
+        state->routing_table[index].candidate=position;
+}
+
+/*
+ * SIFT CANDIDATE
+ *
+ * Move the candidate at the given position of the heap up or down, until it's worse than its parent and better than
+ * its children
+ *
+ * @position: position of the candidate in the heap
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static void sift_candidate(unsigned char position,node_state* state){
+
+        /*
+         * Heap of the candidates
+         */
+
+        unsigned char* candidates=state->parent_candidates;
+
+        /*
+         * Index in the routing table of the candidate being moved
+         */
+
+        unsigned char index=candidates[position];
+
+        /*
+         * Position of the parent or of the best child of the candidate in the heap
+         */
+
+        unsigned int next;
+
+        /*
+         * Move the candidate up, as long as it's better than its parent
+         */
+
+        while(position && is_better_candidate(index,candidates[(position-1)/2],state->routing_table)){
+                next=(position-1)/2;
+                place_candidate(position,candidates[next],state);
+                position=(unsigned char)next;
+        }
+
+        /*
+         * Move the candidate down, as long as one of its children is better than it
+         */
+
+        while((next=2U*position+1)<state->parent_candidates_count){
+
+                /*
+                 * Pick the best child
+                 */
+
+                if(next+1<state->parent_candidates_count &&
+                   is_better_candidate(candidates[next+1],candidates[next],state->routing_table))
+                        next++;
+                if(!is_better_candidate(candidates[next],index,state->routing_table))
+                        break;
+                place_candidate(position,candidates[next],state);
+                position=(unsigned char)next;
+        }
+
+        /*
+         * Store the candidate at its final position
+         */
+
+        place_candidate(position,index,state);
+}
+
+/*
+ * REMOVE CANDIDATE
+ *
+ * Remove the given entry of the routing table from the heap of the candidate parents, if it's there
+ *
+ * @index: index of the entry in the routing table
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static void remove_candidate(unsigned char index,node_state* state){
+
+        /*
+         * Position of the entry in the heap
+         */
+
+        unsigned char position=state->routing_table[index].candidate;
+
+        /*
+         * If the entry is not in the heap, there's nothing to do
+         */
+
+        if(position==NOT_A_CANDIDATE)
+                return;
+        state->routing_table[index].candidate=NOT_A_CANDIDATE;
+
+        /*
+         * Replace the entry with the last candidate of the heap and move the latter to its right position
+         */
+
+        state->parent_candidates_count--;
+        if(position<state->parent_candidates_count){
+                place_candidate(position,state->parent_candidates[state->parent_candidates_count],state);
+                sift_candidate(position,state);
+        }
+}
+
+/*
+ * UPDATE CANDIDATE
+ *
+ * Add, move or remove the given entry of the routing table in the heap of the candidate parents, according to its
+ * current content: it has to be called every time an entry changes
+ *
+ * @index: index of the entry in the routing table
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static void update_candidate(unsigned char index,node_state* state){
+
+        /*
+         * Entry of the routing table
+         */
+
+        routing_table_entry* entry=&state->routing_table[index];
+
+        /*
+         * Check whether the neighbor can be selected as parent: it must have a route which does not pass through this
+         * node (in order to avoid loops), it must not be congested and the link to it must have a 1-hop ETX lower than
+         * MAX_ONE_HOP_ETX
+         */
+
+        if(entry->info.parent==INVALID_ADDRESS || entry->info.parent==state->me || entry->info.congested ||
+           entry->one_hop_etx>=max_one_hop_etx){
+                remove_candidate(index,state);
+                return;
+        }
+
+        /*
+         * The neighbor is a candidate: if it's not in the heap yet, append it at the end
+         */
+
+        if(entry->candidate==NOT_A_CANDIDATE)
+                place_candidate(state->parent_candidates_count++,index,state);
+
+        /*
+         * Move the entry to its right position
+         */
+
+        sift_candidate(entry->candidate,state);
+}
+
+/*
+ * GET BEST CANDIDATE
+ *
+ * Returns the index in the routing table of the best candidate parent other than the actual parent, or NOT_A_CANDIDATE
+ * if there's none
+ *
+ * @state: pointer to the object representing the current state of the node
+ */
+
+static unsigned char get_best_candidate(node_state* state){
+
+        /*
+         * Heap of the candidates
+         */
+
+        unsigned char* candidates=state->parent_candidates;
+
+        /*
+         * Index of the entry of the actual parent in the routing table, if the node has a parent
+         */
+
+        unsigned char parent=state->route.parent!=INVALID_ADDRESS?state->parent_entry:NOT_A_CANDIDATE;
+
+        /*
+         * If there are no candidates, return NOT_A_CANDIDATE
+         */
+
+        if(!state->parent_candidates_count)
+                return NOT_A_CANDIDATE;
+
+        /*
+         * The best candidate is the first one of the heap, unless it's the actual parent: in this case, it's the better
+         * of its children
+         */
+
+        if(candidates[0]!=parent)
+                return candidates[0];
+        if(state->parent_candidates_count==1)
+                return NOT_A_CANDIDATE;
+        if(state->parent_candidates_count>2 && is_better_candidate(candidates[2],candidates[1],state->routing_table))
+                return candidates[2];
+        return candidates[1];
+}
+
+/*
+ * CANDIDATE PARENTS - end
+ */
+
 /*
  * REMOVE ENTRY ROUTING TABLE
  *
@@ -233,6 +506,12 @@ void remove_entry_routing_table(unsigned int address,node_state* state){
                 return;
         }
 
+        /*
+         * The neighbor is no longer a candidate parent
+         */
+
+        remove_candidate(index,state);
+
         /*
          * Removing an entry from the routing table means replacing each entry with the one after it, starting from
          * the entry that has to be removed => first the number of valid entries (associated to neighbors) has to be
@@ -247,6 +526,18 @@ void remove_entry_routing_table(unsigned int address,node_state* state){
 
         for(i=index;i<neighbors;i++)
                 routing_table[i]=routing_table[i+1];
+
+        /*
+         * The candidate parents and the actual parent that came after the removed entry have moved one position back:
+         * since their order is not changed, the heap is still valid
+         */
+
+        for(i=0;i<state->parent_candidates_count;i++){
+                if(state->parent_candidates[i]>index)
+                        state->parent_candidates[i]--;
+        }
+        if(state->parent_entry>index && state->parent_entry!=NOT_A_CANDIDATE)
+                state->parent_entry--;
 }
 
 /*
@@ -289,6 +580,7 @@ void update_neighbor_congested(unsigned int address,node_state* state,bool conge
                  */
 
                 state->routing_table[index].info.congested=congested;
+                update_candidate(index,state);
 
                 /*
                  * If the given node is congested and it's the actual parent or if the actual route is congested and the
@@ -354,7 +646,7 @@ void update_routing_table(unsigned int from, unsigned int parent, unsigned short
          * and the table is full => discard packet
          */
 
-        if(index==ROUTING_TABLE_SIZE){
+        if(index==routing_table_size){
                 return;
         }
         else if(index==state->neighbors){
@@ -392,11 +684,20 @@ void update_routing_table(unsigned int from, unsigned int parent, unsigned short
 
                         routing_table[index].info.congested=false;
 
+                        /*
+                         * Set the 1-hop ETX of the link to the sender and add it to the candidate parents, if it can
+                         * be selected
+                         */
+
+                        routing_table[index].one_hop_etx=one_hop_etx;
+                        routing_table[index].candidate=NOT_A_CANDIDATE;
+
                         /*
                          * Update the counter of neighbors "tracked" in the neighbor table
                          */
 
                         state->neighbors+=1;
+                        update_candidate(index,state);
                 }
         }
         else{
@@ -406,9 +707,11 @@ void update_routing_table(unsigned int from, unsigned int parent, unsigned short
                  * it according to the information brought by the beacon.
                  */
 
-                routing_table[from].info.etx=etx;
-                routing_table[from].info.parent=parent;
-                routing_table[from].neighbor=from;
+                routing_table[index].info.etx=etx;
+                routing_table[index].info.parent=parent;
+                routing_table[index].neighbor=from;
+                routing_table[index].one_hop_etx=one_hop_etx;
+                update_candidate(index,state);
         }
 }
 
@@ -425,12 +728,6 @@ void update_routing_table(unsigned int from, unsigned int parent, unsigned short
 
 void update_route(node_state* state){
 
-        /*
-         * Index used to scan the routing table
-         */
-
-        unsigned char i;
-
         /*
          * Pointer to the route of the current node
          */
@@ -438,28 +735,28 @@ void update_route(node_state* state){
         route_info* route;
 
         /*
-         * Pointer to the current entry of the routing table, used during a scan
+         * Pointer to the entry of the actual parent in the routing table
          */
 
-        routing_table_entry* current_entry;
+        routing_table_entry* parent_entry;
 
         /*
-         * Pointer to the entry with the lowest ETX found so far, used during a scan
+         * Index of the entry with the lowest ETX other than the actual parent
          */
 
-        routing_table_entry* best_entry;
+        unsigned char best_index;
 
         /*
-         * Lowest ETX found so far, while scanning the routing table
+         * Pointer to the entry with the lowest ETX other than the actual parent
          */
 
-        unsigned short min_etx;
+        routing_table_entry* best_entry;
 
         /*
-         * ETX of the current entry of the routing table, used while scanning
+         * Lowest ETX of the entries other than the actual parent
          */
 
-        unsigned short current_etx;
+        unsigned short min_etx;
 
         /*
          * ETX of this node before updating the route; is the ETX of the path that passes throug the actual parent
@@ -468,12 +765,6 @@ void update_route(node_state* state){
 
         unsigned short actual_etx;
 
-        /*
-         * 1-hop ETX of the current entry of the routing table, used while scanning
-         */
-
-        unsigned short current_one_hop_etx;
-
         /*
          * If the current node is the root of the tree, there's no parent to select, so just return false
          */
@@ -481,18 +772,11 @@ void update_route(node_state* state){
         if(state->root)
                 return;
 
-        /*
-         * The current node is not the root => set the above variables before using them to scan the routing table.
-         * Set the best entry to NULL, because the scan has not started yet
-         */
-
-        best_entry=NULL;
-
         /*
          * Initially set the minimum and actual etx to infinite (INFINITE_ETX)
          *
-         * NOTE if the node has not chosen any parent yet, "actual_ETX" will be equal to INFINITE_ETX at the end of the
-         * iteration and a parent will be chosen
+         * NOTE if the node has not chosen any parent yet, "actual_ETX" will be equal to INFINITE_ETX and a parent will
+         * be chosen
          */
 
         min_etx=INFINITE_ETX;
@@ -505,89 +789,39 @@ void update_route(node_state* state){
         route=&state->route;
 
         /*
-         * Scan the entries of the routing table in order to select the new parent of the node
+         * If the node has a parent, update the route with the information in its entry, unless its "parent" field is
+         * not valid or it's set to the ID of the current node
          */
 
-        for(i=0;i<state->neighbors;i++){
-
-                /*
-                 * Get current entry
-                 */
-
-                current_entry=&state->routing_table[i];
-
-                /*
-                 * Skip entries whose "parent" field is not valid or is set to the the same ID as the one of the
-                 * current node, i.e. child nodes (in order to avoid loops)
-                 */
-
-                if((current_entry->info.parent==INVALID_ADDRESS) || (current_entry->info.parent==state->me))
-                        continue;
-
-                /*
-                 * The entry currently selected has a valid "parent" field.
-                 * Contact the link estimator asking for the 1-hop ETX of the neighbor currently analyzed
-                 */
-
-                current_one_hop_etx=get_one_hop_etx(current_entry->neighbor,state->link_estimator_table);
-
-                /*
-                 * Compute the ETX of the route through the current entry of the routing table: it's the sum of the
-                 * ETX declared by the node and the 1-hop ETX of the link to it
-                 */
-
-                current_etx=current_one_hop_etx+current_entry->info.etx;
-
-                /*
-                 * Check whether the node analyzed is the actual parent of the node
-                 */
-
-                if(current_entry->neighbor==route->parent){
+        if(route->parent!=INVALID_ADDRESS){
+                parent_entry=&state->routing_table[state->parent_entry];
+                if((parent_entry->info.parent!=INVALID_ADDRESS) && (parent_entry->info.parent!=state->me)){
 
                         /*
                          * Set the value of the actual ETX to the one of the path through the current parent
                          */
 
-                        actual_etx=current_etx;
-
-                        /*
-                         * In case the node analyzed is the actual parent of the node, update the corresponding entry
-                         * and the "route" variable
-                         */
-
-                        route->etx=current_entry->info.etx;
-                        route->congested=current_entry->info.congested;
+                        actual_etx=get_candidate_etx(parent_entry);
 
                         /*
-                         * Jump to the next entry in the table
+                         * Update the "route" variable
                          */
 
-                        continue;
+                        route->etx=parent_entry->info.etx;
+                        route->congested=parent_entry->info.congested;
                 }
+        }
 
-                /*
-                 * Ignore congested links
-                 */
-
-                if(current_entry->info.congested)
-                        continue;
-
-                /*
-                 * Ignore links whose 1-hop ETX is beyond MAX_ETX
-                 */
-
-                if(current_one_hop_etx>=max_one_hop_etx)
-                        continue;
-
-                /*
-                 * If the ETX of the current entry is less than the lowest ETX found so far in the table, select the
-                 * current entry as chosen candidate for the new parent; then jump to next entry
-                 */
+        /*
+         * Get the best candidate parent other than the actual parent: the candidates are the neighbors with a valid
+         * route not passing through this node, not congested and with a 1-hop ETX lower than MAX_ONE_HOP_ETX
+         */
 
-                if(current_etx<min_etx){
-                        min_etx=current_etx;
-                        best_entry=current_entry;
-                }
+        best_index=get_best_candidate(state);
+        best_entry=NULL;
+        if(best_index!=NOT_A_CANDIDATE){
+                best_entry=&state->routing_table[best_index];
+                min_etx=get_candidate_etx(best_entry);
         }
 
         /*
@@ -659,6 +893,7 @@ void update_route(node_state* state){
                          */
 
                         route->parent=best_entry->neighbor;
+                        state->parent_entry=best_index;
 
                         /*
                          * Then set the corresponding ETX
@@ -740,10 +975,11 @@ void set_beacon_sending_time(node_state* state){
         state->beacon_sending_time=beacon_sending_time/1000.0;
 
         /*
-         * Schedule the sending of the next beacon at the chosen sending time
+         * Schedule the sending of the next beacon at the chosen sending time: this replaces any step of the schedule
+         * of the beacons still pending
          */
 
-        wait_until(state->me,state->lvt+(beacon_sending_time/1000.0),SEND_BEACONS_TIMER_FIRED);
+        start_timer(state,BEACON_TIMER,state->lvt+(beacon_sending_time/1000.0),SEND_BEACONS_TIMER_FIRED);
 }
 
 
@@ -793,7 +1029,7 @@ void schedule_beacons_interval_update(node_state* state){
          * Request an event scheduled at the time in the future when the update will have to be performed
          */
 
-        wait_until(state->me,state->lvt+remaining,SET_BEACONS_TIMER);
+        start_timer(state,BEACON_TIMER,state->lvt+remaining,SET_BEACONS_TIMER);
 }
 
 /*
@@ -984,7 +1220,7 @@ void receive_beacon(ctp_routing_frame* routing_frame, unsigned int from,node_sta
                          * about this
                          */
 
-                        int node_removed=insert_neighbor(from,neighbors_table);
+                        int node_removed=insert_neighbor(from,state);
                         if(node_removed!=-1)
                                 neighbor_evicted((unsigned int)node_removed,state);
                         pin_neighbor(from,neighbors_table);
@@ -1050,6 +1286,58 @@ void neighbor_evicted(unsigned int address,node_state* state){
         }
 }
 
+/*
+ * NEIGHBOR ETX CHANGED
+ *
+ * This function is used by the LINK ESTIMATOR to inform the ROUTING ENGINE about the fact that the 1-hop ETX of the
+ * link to one of its neighbors may have changed => if the neighbor is in the ROUTING TABLE, the ETX of the route through
+ * it is updated, so that the candidate parents stay ordered
+ *
+ * @address: ID of the neighbor
+ * @state: pointer to the object representing the current state of the node
+ */
+
+void neighbor_etx_changed(unsigned int address,node_state* state){
+
+        /*
+         * Index of the entry of the neighbor in the ROUTING TABLE
+         */
+
+        unsigned char index;
+
+        /*
+         * 1-hop ETX of the link to the neighbor
+         */
+
+        unsigned short one_hop_etx;
+
+        /*
+         * Find the entry of the neighbor: if it's the actual parent, its index is already known
+         */
+
+        if(address==state->route.parent && state->parent_entry!=NOT_A_CANDIDATE)
+                index=state->parent_entry;
+        else
+                index=find_index_routing_table(address,state->routing_table,state->neighbors);
+
+        /*
+         * If the neighbor is not in the table, there's nothing to update
+         */
+
+        if(index>=state->neighbors)
+                return;
+
+        /*
+         * Update the entry only if the 1-hop ETX has actually changed
+         */
+
+        one_hop_etx=get_one_hop_etx(address,state->link_estimator_table);
+        if(one_hop_etx!=state->routing_table[index].one_hop_etx){
+                state->routing_table[index].one_hop_etx=one_hop_etx;
+                update_candidate(index,state);
+        }
+}
+
 /*
  * SHOULD THE NEIGHBOR BE INSERTED?
  *
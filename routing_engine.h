@@ -14,7 +14,7 @@ typedef struct _route_info route_info;
  */
 
 #ifndef ROUTING_TABLE_SIZE
-#define ROUTING_TABLE_SIZE 10 // Number of entries in the routing table
+#define ROUTING_TABLE_SIZE 10 // Default number of entries in the routing table
 #endif
 
 #ifndef UPDATE_ROUTE_TIMER
@@ -46,6 +46,10 @@ typedef struct _route_info route_info;
 #define INFINITE_ETX 0xFFFF // Highest value for ETX => it's used to avoid that neighbor is selected as parent
 #endif
 
+#ifndef NOT_A_CANDIDATE
+#define NOT_A_CANDIDATE 0xff // Position in the heap of the candidate parents of an entry that is not a candidate
+#endif
+
 /*
  * Minimum value (max frequency) for the interval between two beacons sent (in seconds)
  */
@@ -65,6 +69,7 @@ typedef struct _route_info route_info;
 /* ROUTING ENGINE API */
 
 void neighbor_evicted(unsigned int address,node_state* state);
+void neighbor_etx_changed(unsigned int address,node_state* state);
 bool get_etx(unsigned short* etx,node_state* state);
 unsigned int get_parent(node_state* state);
 void update_route(node_state* state);
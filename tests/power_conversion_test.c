@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "../power_conversion.h"
+
+/*
+ * POWER CONVERSION TEST
+ *
+ * Standalone test of the conversions between dBm and mW (see "power_conversion.h"): the results are compared against
+ * the functions "pow" and "log10" of the math library over a dense sweep of values, and the conversion of whole arrays
+ * has to give exactly the same bits as the conversion of the single values.
+ *
+ * Build and run it with
+ *
+ * make -C tests check
+ *
+ * The test exits with EXIT_FAILURE at the first check that fails
+ */
+
+/*
+ * Highest relative error of the conversion from dBm to mW and highest error (in dB) of the conversion from mW to dBm,
+ * as documented in "power_conversion.h"
+ */
+
+#define MAX_RELATIVE_ERROR 1e-8
+#define MAX_DBM_ERROR 1e-7
+
+/*
+ * Range and step (in dBm) of the sweep of the conversion from dBm to mW: it covers the values the simulation deals with
+ * by far (gains, noise floors and thresholds), without reaching the subnormal values in mW
+ */
+
+#define SWEEP_MIN_DBM -3000.0
+#define SWEEP_MAX_DBM 3000.0
+#define SWEEP_STEP_DBM 0.001
+
+/*
+ * Number of values per decade of the sweep of the conversion from mW to dBm
+ */
+
+#define SWEEP_STEPS_PER_DECADE 10000
+
+/*
+ * CHECK DBM TO MW
+ *
+ * Compare the conversion from dBm to mW against "pow" over the sweep and return the highest relative error found
+ */
+
+static double check_dbm_to_mw(){
+
+        /*
+         * Number of values of the sweep and index of the current one
+         */
+
+        long steps=(long)((SWEEP_MAX_DBM-SWEEP_MIN_DBM)/SWEEP_STEP_DBM);
+        long step;
+
+        /*
+         * Current value (in dBm), expected and actual values (in mW), relative error and highest one
+         */
+
+        double dbm;
+        double expected;
+        double actual;
+        double error;
+        double max_error=0;
+
+        for(step=0;step<=steps;step++){
+                dbm=SWEEP_MIN_DBM+step*SWEEP_STEP_DBM;
+                expected=pow(10.0,dbm/10.0);
+                actual=dbm_to_mw(dbm);
+                error=fabs(actual-expected)/expected;
+                if(!(error<MAX_RELATIVE_ERROR)){
+                        printf("[FAILED] dbm_to_mw(%.17g)=%.17g, expected %.17g (relative error %g)\n",dbm,actual,
+                               expected,error);
+                        exit(EXIT_FAILURE);
+                }
+                if(error>max_error)
+                        max_error=error;
+        }
+        return max_error;
+}
+
+/*
+ * CHECK MW TO DBM
+ *
+ * Compare the conversion from mW to dBm against "log10" over the sweep, subnormal values included, and return the
+ * highest error (in dB) found
+ */
+
+static double check_mw_to_dbm(){
+
+        /*
+         * Lowest and highest decade of the sweep and index of the current value
+         */
+
+        long first=-320*SWEEP_STEPS_PER_DECADE;
+        long last=300*SWEEP_STEPS_PER_DECADE;
+        long step;
+
+        /*
+         * Current value (in mW), expected and actual values (in dBm), error and highest one
+         */
+
+        double mw;
+        double expected;
+        double actual;
+        double error;
+        double max_error=0;
+
+        for(step=first;step<=last;step++){
+                mw=pow(10.0,(double)step/SWEEP_STEPS_PER_DECADE);
+                expected=10.0*log10(mw);
+                actual=mw_to_dbm(mw);
+                error=fabs(actual-expected);
+                if(!(error<MAX_DBM_ERROR)){
+                        printf("[FAILED] mw_to_dbm(%.17g)=%.17g, expected %.17g (error %g dB)\n",mw,actual,expected,
+                               error);
+                        exit(EXIT_FAILURE);
+                }
+                if(error>max_error)
+                        max_error=error;
+        }
+        return max_error;
+}
+
+/*
+ * CHECK SPECIAL VALUES
+ *
+ * Check the values out of the range of the conversions: the values in dBm are clamped, the powers that are not positive
+ * have no value in dBm and infinity stays the same
+ */
+
+static void check_special_values(){
+        if(dbm_to_mw(-HUGE_VAL)!=dbm_to_mw(MIN_CONVERTIBLE_DBM) || dbm_to_mw(HUGE_VAL)!=dbm_to_mw(MAX_CONVERTIBLE_DBM)){
+                printf("[FAILED] dbm_to_mw doesn't clamp the values out of its range\n");
+                exit(EXIT_FAILURE);
+        }
+        if(mw_to_dbm(0)!=-HUGE_VAL || mw_to_dbm(-1)!=-HUGE_VAL || mw_to_dbm(NAN)!=-HUGE_VAL){
+                printf("[FAILED] mw_to_dbm doesn't return minus infinity for the powers that are not positive\n");
+                exit(EXIT_FAILURE);
+        }
+        if(mw_to_dbm(HUGE_VAL)!=HUGE_VAL){
+                printf("[FAILED] mw_to_dbm doesn't return infinity for infinity\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * CHECK ARRAY
+ *
+ * Convert the sweep of values in dBm as a whole array, in place and not, and check that each result has the same bits of
+ * the conversion of the single value: the values out of the range are included, and arrays of every length up to a few
+ * elements are converted, so both the vector and the scalar parts of the conversion are covered
+ */
+
+static void check_array(){
+
+        /*
+         * Number of values, index of the current one and length of the short arrays
+         */
+
+        long count=(long)((SWEEP_MAX_DBM-SWEEP_MIN_DBM)/SWEEP_STEP_DBM)+3;
+        long index;
+        unsigned int length;
+        unsigned int element;
+
+        /*
+         * Conversion of the single value
+         */
+
+        double expected;
+
+        /*
+         * Values in dBm, their conversion and their copy converted in place
+         */
+
+        double* dbm=malloc(sizeof(double)*count);
+        double* mw=malloc(sizeof(double)*count);
+        double* in_place=malloc(sizeof(double)*count);
+        if(!dbm || !mw || !in_place){
+                printf("[FAILED] Not enough memory for the arrays\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Fill the values: the sweep and two values out of the range
+         */
+
+        for(index=0;index<count-2;index++)
+                dbm[index]=SWEEP_MIN_DBM+index*SWEEP_STEP_DBM;
+        dbm[count-2]=-HUGE_VAL;
+        dbm[count-1]=HUGE_VAL;
+        memcpy(in_place,dbm,sizeof(double)*count);
+
+        /*
+         * Convert the whole arrays
+         */
+
+        dbm_to_mw_array(dbm,mw,(unsigned int)count);
+        dbm_to_mw_array(in_place,in_place,(unsigned int)count);
+        for(index=0;index<count;index++){
+                expected=dbm_to_mw(dbm[index]);
+                if(memcmp(&mw[index],&expected,sizeof(double)) || memcmp(&in_place[index],&expected,sizeof(double))){
+                        printf("[FAILED] dbm_to_mw_array converts %.17g to %.17g, dbm_to_mw to %.17g\n",dbm[index],
+                               mw[index],expected);
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        /*
+         * Convert arrays of every length up to 8, starting at an odd position too
+         */
+
+        for(length=0;length<=8;length++){
+                for(index=0;index<2;index++){
+                        memset(mw,0,sizeof(double)*9);
+                        dbm_to_mw_array(&dbm[count-11+index],mw,length);
+                        for(element=0;element<length;element++){
+                                expected=dbm_to_mw(dbm[count-11+index+element]);
+                                if(memcmp(&mw[element],&expected,sizeof(double))){
+                                        printf("[FAILED] dbm_to_mw_array differs from dbm_to_mw on arrays of %u "
+                                                       "elements\n",length);
+                                        exit(EXIT_FAILURE);
+                                }
+                        }
+                        if(mw[length]!=0){
+                                printf("[FAILED] dbm_to_mw_array writes past the end of an array of %u elements\n",
+                                       length);
+                                exit(EXIT_FAILURE);
+                        }
+                }
+        }
+
+        free(dbm);
+        free(mw);
+        free(in_place);
+}
+
+int main(){
+
+        /*
+         * Highest errors of the two conversions
+         */
+
+        double dbm_to_mw_error=check_dbm_to_mw();
+        double mw_to_dbm_error=check_mw_to_dbm();
+
+        check_special_values();
+        check_array();
+
+        printf("dbm_to_mw: highest relative error %g (bound %g)\n",dbm_to_mw_error,MAX_RELATIVE_ERROR);
+        printf("mw_to_dbm: highest error %g dB (bound %g dB)\n",mw_to_dbm_error,MAX_DBM_ERROR);
+        printf("dbm_to_mw_array: same bits as dbm_to_mw\n");
+        return EXIT_SUCCESS;
+}
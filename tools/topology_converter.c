@@ -0,0 +1,499 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "../topology_format.h"
+
+/*
+ * TOPOLOGY CONVERTER
+ *
+ * Offline tool that converts the description of the topology of the network from the text format to the binary format
+ * (see "topology_format.h"), which the simulation maps in memory instead of parsing it line by line.
+ * The input can be either an input file of the simulation or the file "linkgain.out" created by the LinkLayerModel:
+ * both contain lines with this syntax
+ *
+ * "gain"\t source_node_id\t sink_node_id\t link_gain\n
+ * "noise"\t node_id\t noise_floor\t gaussian_white_noise\n
+ *
+ * The only difference is that the LinkLayerModel may print the values of the noise with the decimal separator of the
+ * current locale, so a comma is accepted as decimal separator as well.
+ *
+ * Build it with
+ *
+ * gcc -O2 -o topology_converter topology_converter.c -lm
+ *
+ * and run it with
+ *
+ * ./topology_converter input_file output_file [number_of_nodes]
+ *
+ * If the number of nodes is not given, it is the highest node ID found in the input file plus one: it has to coincide
+ * with the number of LPs of the simulation.
+ * The gains are stored in hundredths of dB (see GAIN_RESOLUTION): a gain that doesn't fit in 16 bits is an error.
+ */
+
+/*
+ * LINK
+ *
+ * A link read from the input file
+ */
+
+typedef struct _link{
+        unsigned int source; // ID of the source node
+        unsigned int sink; // ID of the sink node
+        int16_t gain; // Gain of the link, in hundredths of dB
+}link;
+
+/*
+ * Links read from the input file, their number and the number of elements allocated
+ */
+
+link* links=NULL;
+unsigned long links_count=0;
+unsigned long links_capacity=0;
+
+/*
+ * Noise of each node, the number of elements allocated and a flag for each node telling whether its noise has been read
+ */
+
+topology_noise* noise=NULL;
+unsigned char* noise_read=NULL;
+unsigned int noise_capacity=0;
+
+/*
+ * Highest node ID read from the input file, plus one
+ */
+
+unsigned int nodes=0;
+
+/*
+ * PARSE VALUE
+ *
+ * Parse a decimal value, accepting both a dot and a comma as decimal separator
+ *
+ * @token: string containing the value
+ * @value: pointer to the variable where the value is stored
+ *
+ * Returns 1 if the value is valid, 0 otherwise
+ */
+
+int parse_value(char* token,double* value){
+
+        /*
+         * Replace the comma with a dot
+         */
+
+        char* comma=strchr(token,',');
+        if(comma)
+                *comma='.';
+
+        /*
+         * Parse the value
+         */
+
+        return sscanf(token,"%lf",value)==1;
+}
+
+/*
+ * GROW NOISE
+ *
+ * Make room for the noise of the node with the given ID
+ *
+ * @node: ID of the node
+ */
+
+void grow_noise(unsigned int node){
+
+        /*
+         * New number of elements
+         */
+
+        unsigned int capacity=noise_capacity?noise_capacity:64;
+
+        /*
+         * Check if there's already room for the node
+         */
+
+        if(node<noise_capacity)
+                return;
+
+        /*
+         * Double the number of elements until there's room for the node
+         */
+
+        while(capacity<=node)
+                capacity*=2;
+
+        /*
+         * Resize the arrays and initialize the new elements
+         */
+
+        noise=realloc(noise,sizeof(topology_noise)*capacity);
+        noise_read=realloc(noise_read,capacity);
+        if(!noise || !noise_read){
+                printf("[FATAL ERROR] Not enough memory\n");
+                exit(EXIT_FAILURE);
+        }
+        memset(&noise[noise_capacity],0,sizeof(topology_noise)*(capacity-noise_capacity));
+        memset(&noise_read[noise_capacity],0,capacity-noise_capacity);
+        noise_capacity=capacity;
+}
+
+/*
+ * READ TEXT FILE
+ *
+ * Read all the links and the noise of the nodes from the input file
+ *
+ * @path: filename of the input file
+ */
+
+void read_text_file(const char* path){
+
+        /*
+         * Number of current line read from the file
+         */
+
+        unsigned long lines=0;
+
+        /*
+         * Buffer for the line and its size, allocated by "getline"
+         */
+
+        size_t len=0;
+        char* lineptr=NULL;
+
+        /*
+         * Open the input file
+         */
+
+        FILE* file=fopen(path,"r");
+        if(!file){
+                printf("[FATAL ERROR] Provided path doesn't correspond to any file or it cannot be accessed\n");
+                exit(EXIT_FAILURE);
+        }
+
+        /*
+         * Read the file line by line
+         */
+
+        while(getline(&lineptr,&len,file)!=-1){
+
+                /*
+                 * Type of the line and the further three tokens
+                 */
+
+                char* line_type;
+                char* tokens[3];
+
+                /*
+                 * IDs of the nodes and value read
+                 */
+
+                unsigned int first;
+                unsigned int second=0;
+                double value;
+
+                /*
+                 * Index variable
+                 */
+
+                unsigned short index;
+
+                lines++;
+
+                /*
+                 * Skip empty lines
+                 */
+
+                line_type=strtok(lineptr,"\t\r\n");
+                if(!line_type)
+                        continue;
+
+                /*
+                 * Get further three tokens
+                 */
+
+                for(index=0;index<3;index++){
+                        tokens[index]=strtok(NULL,"\t\r\n");
+                        if(!tokens[index]){
+                                printf("[FATAL ERROR] Line %lu of the file is not well formed\n",lines);
+                                exit(EXIT_FAILURE);
+                        }
+                }
+
+                /*
+                 * Parse the line depending on its type
+                 */
+
+                if(!strcmp(line_type,"gain")){
+
+                        /*
+                         * The line describes the gain of a link
+                         */
+
+                        if(sscanf(tokens[0],"%u",&first)!=1 || sscanf(tokens[1],"%u",&second)!=1 ||
+                           !parse_value(tokens[2],&value) || first==second){
+                                printf("[FATAL ERROR] Line %lu of the file is not well formed\n",lines);
+                                exit(EXIT_FAILURE);
+                        }
+
+                        /*
+                         * Check that the gain fits in 16 bits once quantized
+                         */
+
+                        value=nearbyint(value*GAIN_RESOLUTION);
+                        if(!(value>INT16_MIN && value<=INT16_MAX)){
+                                printf("[FATAL ERROR] The gain at line %lu is out of the range that can be stored\n",
+                                       lines);
+                                exit(EXIT_FAILURE);
+                        }
+
+                        /*
+                         * Make room for the link, doubling the array if it's full
+                         */
+
+                        if(links_count==links_capacity){
+                                links_capacity=links_capacity?links_capacity*2:1024;
+                                links=realloc(links,sizeof(link)*links_capacity);
+                                if(!links){
+                                        printf("[FATAL ERROR] Not enough memory\n");
+                                        exit(EXIT_FAILURE);
+                                }
+                        }
+
+                        /*
+                         * Store the link
+                         */
+
+                        links[links_count].source=first;
+                        links[links_count].sink=second;
+                        links[links_count].gain=(int16_t)value;
+                        links_count++;
+                }
+                else if(!strcmp(line_type,"noise")){
+
+                        /*
+                         * The line describes the noise of a node
+                         */
+
+                        double range;
+                        if(sscanf(tokens[0],"%u",&first)!=1 || !parse_value(tokens[1],&value) ||
+                           !parse_value(tokens[2],&range)){
+                                printf("[FATAL ERROR] Line %lu of the file is not well formed\n",lines);
+                                exit(EXIT_FAILURE);
+                        }
+
+                        /*
+                         * Store the noise of the node
+                         */
+
+                        grow_noise(first);
+                        noise[first].noise_floor=value;
+                        noise[first].range=range;
+                        noise_read[first]=1;
+                }
+                else{
+                        printf("[FATAL ERROR] Line %lu of the file is not well formed\n"
+                                       "It has to start with either \"noise\" or \"gain\"\n",lines);
+                        exit(EXIT_FAILURE);
+                }
+
+                /*
+                 * Update the number of nodes
+                 */
+
+                if(first+1>nodes)
+                        nodes=first+1;
+                if(second+1>nodes)
+                        nodes=second+1;
+        }
+
+        free(lineptr);
+        fclose(file);
+}
+
+/*
+ * WRITE SECTION
+ *
+ * Write a section of the binary file and pad it to a multiple of 8 bytes
+ *
+ * @file: the output file
+ * @buffer: content of the section
+ * @size: size of the section
+ */
+
+void write_section(FILE* file,const void* buffer,size_t size){
+
+        /*
+         * Padding bytes
+         */
+
+        static const char padding[8]={0};
+
+        if(fwrite(buffer,1,size,file)!=size || fwrite(padding,1,(8-size%8)%8,file)!=(8-size%8)%8){
+                printf("[FATAL ERROR] The output file cannot be written\n");
+                exit(EXIT_FAILURE);
+        }
+}
+
+/*
+ * WRITE BINARY FILE
+ *
+ * Group the links by source node (keeping the order of the input file) and write the binary file
+ *
+ * @path: filename of the output file
+ */
+
+void write_binary_file(const char* path){
+
+        /*
+         * Header of the file
+         */
+
+        topology_header header;
+
+        /*
+         * Offsets, sinks and gains of the links grouped by source node
+         */
+
+        uint32_t* offsets;
+        uint32_t* sinks;
+        int16_t* gains;
+
+        /*
+         * Position of the next link of each node
+         */
+
+        uint32_t* next_position;
+
+        /*
+         * Index variables
+         */
+
+        unsigned long index;
+        unsigned int node;
+
+        /*
+         * The output file
+         */
+
+        FILE* file;
+
+        /*
+         * Check that all the nodes have their noise
+         */
+
+        grow_noise(nodes);
+        for(node=0;node<nodes;node++){
+                if(!noise_read[node]){
+                        printf("[FATAL ERROR] Noise for node %u is not given\n",node);
+                        exit(EXIT_FAILURE);
+                }
+        }
+
+        /*
+         * Count the links of each node and compute the offsets
+         */
+
+        offsets=calloc(nodes+1,sizeof(uint32_t));
+        next_position=calloc(nodes,sizeof(uint32_t));
+        sinks=malloc(sizeof(uint32_t)*(links_count?links_count:1));
+        gains=malloc(sizeof(int16_t)*(links_count?links_count:1));
+        if(!offsets || !next_position || !sinks || !gains){
+                printf("[FATAL ERROR] Not enough memory\n");
+                exit(EXIT_FAILURE);
+        }
+        for(index=0;index<links_count;index++)
+                next_position[links[index].source]++;
+        for(node=0;node<nodes;node++){
+                offsets[node+1]=offsets[node]+next_position[node];
+                next_position[node]=offsets[node];
+        }
+
+        /*
+         * Copy each link in the next position of its source node
+         */
+
+        for(index=0;index<links_count;index++){
+                sinks[next_position[links[index].source]]=links[index].sink;
+                gains[next_position[links[index].source]]=links[index].gain;
+                next_position[links[index].source]++;
+        }
+
+        /*
+         * Fill the header: each section starts right after the previous one, at a multiple of 8 bytes
+         */
+
+        memset(&header,0,sizeof(topology_header));
+        memcpy(header.magic,TOPOLOGY_MAGIC,TOPOLOGY_MAGIC_LENGTH);
+        header.version=TOPOLOGY_VERSION;
+        header.nodes=nodes;
+        header.links=links_count;
+        header.offsets_position=(sizeof(topology_header)+7)/8*8;
+        header.sinks_position=header.offsets_position+(sizeof(uint32_t)*(nodes+1)+7)/8*8;
+        header.gains_position=header.sinks_position+(sizeof(uint32_t)*links_count+7)/8*8;
+        header.noise_position=header.gains_position+(sizeof(int16_t)*links_count+7)/8*8;
+
+        /*
+         * Write the file
+         */
+
+        file=fopen(path,"wb");
+        if(!file){
+                printf("[FATAL ERROR] The output file cannot be created\n");
+                exit(EXIT_FAILURE);
+        }
+        write_section(file,&header,sizeof(topology_header));
+        write_section(file,offsets,sizeof(uint32_t)*(nodes+1));
+        write_section(file,sinks,sizeof(uint32_t)*links_count);
+        write_section(file,gains,sizeof(int16_t)*links_count);
+        write_section(file,noise,sizeof(topology_noise)*nodes);
+        if(fclose(file)){
+                printf("[FATAL ERROR] The output file cannot be written\n");
+                exit(EXIT_FAILURE);
+        }
+
+        free(offsets);
+        free(next_position);
+        free(sinks);
+        free(gains);
+}
+
+int main(int argc,char** argv){
+
+        /*
+         * Check the arguments
+         */
+
+        if(argc<3 || argc>4){
+                printf("Usage: %s input_file output_file [number_of_nodes]\n",argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        /*
+         * Read the text file
+         */
+
+        read_text_file(argv[1]);
+
+        /*
+         * If the number of nodes is given, check that it's not lower than the IDs in the file
+         */
+
+        if(argc==4){
+                unsigned int given_nodes;
+                if(sscanf(argv[3],"%u",&given_nodes)!=1 || given_nodes<nodes){
+                        printf("[FATAL ERROR] The number of nodes has to be higher than all the node IDs\n");
+                        return EXIT_FAILURE;
+                }
+                nodes=given_nodes;
+        }
+
+        /*
+         * Write the binary file
+         */
+
+        write_binary_file(argv[2]);
+
+        printf("Converted %lu links of %u nodes\n",links_count,nodes);
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#ifndef SENSORSNETWORKMODELPROJECT_TOPOLOGY_FORMAT_H
+#define SENSORSNETWORKMODELPROJECT_TOPOLOGY_FORMAT_H
+
+#include <stdint.h>
+
+/*
+ * BINARY TOPOLOGY FORMAT
+ *
+ * Binary representation of the topology of the network, equivalent to the text input file (see "read_input_file") but
+ * laid out so that the simulation can map it in memory and use it as it is, without parsing it:
+ *
+ * HEADER | OFFSETS | SINKS | GAINS | NOISE
+ *
+ * 1-HEADER: an instance of "topology_header" (see below)
+ * 2-OFFSETS: "nodes"+1 unsigned 32-bit integers; the links having node i as source are the ones from position
+ *   offsets[i] to position offsets[i+1] (excluded) of the next two arrays
+ * 3-SINKS: "links" unsigned 32-bit integers, the ID of the sink node of each link
+ * 4-GAINS: "links" signed 16-bit integers, the gain of each link in hundredths of dB (see GAIN_RESOLUTION): the
+ *   simulation uses them as they are, without converting them back to doubles
+ * 5-NOISE: "nodes" couples of doubles, the noise floor and the range of the white noise of each node (in dBm)
+ *
+ * Each section starts at the position (in bytes, from the beginning of the file) given in the header; all the
+ * positions are multiple of 8, so every array is properly aligned once the file is mapped in memory.
+ * All the values are stored with the byte order of the machine that created the file.
+ * The file is created from the text input file (or from the "linkgain.out" file created by the LinkLayerModel) by the
+ * converter in the "tools" folder.
+ */
+
+/*
+ * First bytes of every file in the binary format
+ */
+
+#ifndef TOPOLOGY_MAGIC
+#define TOPOLOGY_MAGIC "WSNTOPO"
+#endif
+
+/*
+ * Length of the magic string, including the terminating character
+ */
+
+#ifndef TOPOLOGY_MAGIC_LENGTH
+#define TOPOLOGY_MAGIC_LENGTH 8
+#endif
+
+/*
+ * Version of the format: it has to be changed whenever the layout of the file changes
+ */
+
+#ifndef TOPOLOGY_VERSION
+#define TOPOLOGY_VERSION 2
+#endif
+
+/*
+ * Number of steps per dB of the quantized gains: the LinkLayerModel rounds the gains to 0.01 dB, so they are stored
+ * exactly as 16-bit integers, in the range [-327.68,327.67] dB
+ */
+
+#ifndef GAIN_RESOLUTION
+#define GAIN_RESOLUTION 100
+#endif
+
+/*
+ * TOPOLOGY HEADER
+ *
+ * Header of a file in the binary format
+ */
+
+typedef struct _topology_header{
+        char magic[TOPOLOGY_MAGIC_LENGTH]; // Equal to TOPOLOGY_MAGIC
+        uint32_t version; // Version of the format
+        uint32_t nodes; // Number of nodes of the network
+        uint64_t links; // Number of links of the network
+        uint64_t offsets_position; // Position of the array of the offsets
+        uint64_t sinks_position; // Position of the array of the sink nodes
+        uint64_t gains_position; // Position of the array of the gains
+        uint64_t noise_position; // Position of the array of the noise
+}topology_header;
+
+/*
+ * TOPOLOGY NOISE
+ *
+ * Noise of a node in the binary format: it has the same layout as "noise_entry"
+ */
+
+typedef struct _topology_noise{
+        double noise_floor; // Noise floor of the node
+        double range; // Range of the white noise of the node
+}topology_noise;
+
+#endif //SENSORSNETWORKMODELPROJECT_TOPOLOGY_FORMAT_H